@@ -0,0 +1,162 @@
+#include "SharedStateReader.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+//Number of times to retry copying a slot that was being written while we read it
+#define MAX_READ_RETRIES 4
+
+SharedStateReader::SharedStateReader() {
+    state = NULL;
+    epoch = 0;
+    lastTick = 0;
+    missedFrames = 0;
+}
+
+SharedStateReader::~SharedStateReader() {
+    close();
+}
+
+//Maps the shared memory. Returns false if BounceBox hasn't created it yet or it is from another version
+bool SharedStateReader::open() {
+    int fd = shm_open(SHARED_STATE_NAME, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    void *mem = mmap(NULL, sizeof(sharedState), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+
+    state = (const sharedState *)mem;
+    if (!checkHeader()) {
+        fprintf(stderr, "SharedStateReader: %s is not a compatible BounceBox state\n", SHARED_STATE_NAME);
+        close();
+        return false;
+    }
+
+    lastTick = state->latestTick;
+    missedFrames = 0;
+    return true;
+}
+
+//Checks the header is from a compatible BounceBox that has finished setting it up, and takes its epoch
+bool SharedStateReader::checkHeader() {
+    if (state->magic != SHARED_STATE_MAGIC) {
+        return false;
+    }
+    __sync_synchronize();
+
+    if (state->version != SHARED_STATE_VERSION || state->slotSize != sizeof(sharedSlot)) {
+        return false;
+    }
+
+    epoch = state->epoch;
+    return true;
+}
+
+//Starts again from the first frame if BounceBox has restarted since the last read
+//Returns false if the state is being set up or is no longer compatible
+bool SharedStateReader::sync() {
+    if (state->magic != SHARED_STATE_MAGIC) {
+        return false;
+    }
+    __sync_synchronize();
+
+    if (state->epoch != epoch || state->latestTick < lastTick) {
+        if (!checkHeader()) {
+            return false;
+        }
+        lastTick = 0;
+    }
+    return true;
+}
+
+void SharedStateReader::close() {
+    if (state != NULL) {
+        munmap((void *)state, sizeof(sharedState));
+        state = NULL;
+    }
+}
+
+//Copies the most recent frame. Returns false if there is none or it couldn't be read consistently
+bool SharedStateReader::readLatest(sharedFrame &frame) {
+    if (state == NULL || !sync()) {
+        return false;
+    }
+
+    uint64_t tick = state->latestTick;
+    if (tick == 0 || !readTick(tick, frame)) {
+        return false;
+    }
+
+    lastTick = tick;
+    return true;
+}
+
+//Copies the frame after the last one read, so that no bounce events are skipped
+//Returns false if there is no new frame. If the reader fell too far behind, the frames it
+//missed are counted and it carries on from the oldest frame still in the ring
+bool SharedStateReader::readNext(sharedFrame &frame) {
+    if (state == NULL || !sync()) {
+        return false;
+    }
+
+    uint64_t latestTick = state->latestTick;
+    if (latestTick <= lastTick) {
+        return false;
+    }
+
+    uint64_t tick = lastTick + 1;
+    if (latestTick - tick >= SHARED_STATE_NUM_SLOTS - 1) {
+        //Leave a slot of margin as the writer may already be overwriting the oldest one
+        uint64_t oldestTick = latestTick - (SHARED_STATE_NUM_SLOTS - 2);
+        missedFrames += oldestTick - tick;
+        tick = oldestTick;
+    }
+
+    while (!readTick(tick, frame)) {
+        //Overwritten while we were reading it, skip ahead
+        missedFrames++;
+        tick++;
+        if (tick > state->latestTick) {
+            lastTick = tick - 1;
+            return false;
+        }
+    }
+
+    lastTick = tick;
+    return true;
+}
+
+uint64_t SharedStateReader::getMissedFrames() {
+    return missedFrames;
+}
+
+//Copies the frame for the given tick, checking that it wasn't being written or overwritten during the copy
+bool SharedStateReader::readTick(uint64_t tick, sharedFrame &frame) {
+    const sharedSlot *slot = &state->slots[tick % SHARED_STATE_NUM_SLOTS];
+
+    for (int i = 0; i < MAX_READ_RETRIES; i++) {
+        uint32_t seqBefore = slot->seq;
+        if (seqBefore & 1) {
+            continue;
+        }
+        __sync_synchronize();
+
+        memcpy(&frame, (const void *)&slot->frame, sizeof(sharedFrame));
+
+        __sync_synchronize();
+        uint32_t seqAfter = slot->seq;
+        if (seqBefore == seqAfter) {
+            //A consistent copy, but of a newer frame if the writer has lapped us
+            return frame.tick == tick;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "SharedState.h"
+
+//Reads frames that BounceBox publishes into shared memory
+//The memory is mapped read-only, so readers can never block or corrupt the app
+class SharedStateReader
+{
+public:
+    SharedStateReader();
+    ~SharedStateReader();
+    bool open();
+    void close();
+    bool readLatest(sharedFrame &frame);
+    bool readNext(sharedFrame &frame);
+    uint64_t getMissedFrames();
+private:
+    bool readTick(uint64_t tick, sharedFrame &frame);
+    bool checkHeader();
+    bool sync();
+
+    const sharedState *state;
+    uint32_t epoch;
+    uint64_t lastTick;
+    uint64_t missedFrames;
+};
@@ -0,0 +1,48 @@
+#include "SharedStateReader.h"
+#include <stdio.h>
+#include <unistd.h>
+
+//Polls for new frames and prints the token position and every bounce
+//Run it alongside BounceBox on the same machine
+
+#define POLL_INTERVAL_US 5000
+
+static const char *faceNames[] = {"front", "back", "left", "right", "top", "bottom"};
+
+int main() {
+    SharedStateReader reader;
+
+    printf("Waiting for BounceBox...\n");
+    while (!reader.open()) {
+        sleep(1);
+    }
+
+    sharedFrame frame;
+    uint64_t reportedMissed = 0;
+    while (true) {
+        if (!reader.readNext(frame)) {
+            usleep(POLL_INTERVAL_US);
+            continue;
+        }
+
+        if (frame.tick % 60 == 0) {
+            printf("tick %llu: token %s at (%.1f, %.1f), %u spheres in %u boxes\n",
+                (unsigned long long)frame.tick, frame.tokenFound ? "found" : "lost",
+                frame.displayTokenPos.x, frame.displayTokenPos.y, frame.numSpheres, frame.numShards);
+        }
+
+        for (uint32_t i = 0; i < frame.numBounces; i++) {
+            const sharedBounce &bounce = frame.bounces[i];
+            printf("tick %llu: bounce on %s face of box %d at (%.1f, %.1f, %.1f)\n",
+                (unsigned long long)frame.tick, faceNames[bounce.faceIndex], bounce.shard,
+                bounce.hitPt.x, bounce.hitPt.y, bounce.hitPt.z);
+        }
+
+        if (reader.getMissedFrames() != reportedMissed) {
+            reportedMissed = reader.getMissedFrames();
+            printf("missed %llu frames so far\n", (unsigned long long)reportedMissed);
+        }
+    }
+
+    return 0;
+}
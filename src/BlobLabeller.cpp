@@ -0,0 +1,219 @@
+#include "BlobLabeller.h"
+#include <limits.h>
+
+//Sorts blobs so the largest come first, as ofxCvContourFinder does
+static bool isLarger(const labelledBlob &a, const labelledBlob &b) {
+    return a.area > b.area;
+}
+
+BlobLabeller::BlobLabeller() {
+    nBlobs = 0;
+}
+
+//Labels every non-zero pixel of the mask and keeps up to maxBlobs blobs whose area is within [minArea, maxArea]
+//The mask must be tightly packed, one byte per pixel. Returns the number of blobs found
+int BlobLabeller::findBlobs(unsigned char *mask, int width, int height, int minArea, int maxArea, int maxBlobs) {
+    labelBand(mask, width, 0, height);
+    collectBlobs(minArea, maxArea, maxBlobs);
+    return nBlobs;
+}
+
+//Labels numRows tightly packed rows of a mask, the first of which is row firstRow of the whole mask
+//Blobs aren't collected, the band is meant to be passed to mergeBands
+void BlobLabeller::labelBand(unsigned char *rows, int width, int firstRow, int numRows) {
+    clear();
+
+    for (int y = 0; y < numRows; y++) {
+        unsigned char *row = rows + y * width;
+        currRuns.clear();
+
+        //Index of the first run on the previous row that could still touch a run on this row
+        unsigned int prevIndex = 0;
+
+        int x = 0;
+        while (x < width) {
+            //Skip background
+            while (x < width && row[x] == 0) { x++; }
+            if (x == width) { break; }
+
+            //Find the end of this run of foreground
+            int start = x;
+            while (x < width && row[x] != 0) { x++; }
+            int end = x;
+
+            //Runs on the previous row are touching (8-connected) if they cover any pixel in [start - 1, end]
+            while (prevIndex < prevRuns.size() && prevRuns[prevIndex].end < start) { prevIndex++; }
+
+            int label = -1;
+            for (unsigned int i = prevIndex; i < prevRuns.size() && prevRuns[i].start <= end; i++) {
+                if (label < 0) {
+                    label = findRoot(prevRuns[i].label);
+                } else {
+                    label = join(label, prevRuns[i].label);
+                }
+            }
+
+            if (label < 0) {
+                label = newLabel();
+            }
+
+            addRun(label, firstRow + y, start, end);
+        }
+
+        //Keep the runs on the edges of the band for joining to neighbouring bands
+        if (y == 0) {
+            firstRowRuns = currRuns;
+        }
+        prevRuns.swap(currRuns);
+    }
+}
+
+//Collects the blobs of consecutive bands, top to bottom, joining blobs that touch across the seams between them
+//Returns the number of blobs found
+int BlobLabeller::mergeBands(vector<BlobLabeller> &bands, int minArea, int maxArea, int maxBlobs) {
+    clear();
+
+    int prevOffset = 0;
+    for (unsigned int i = 0; i < bands.size(); i++) {
+        BlobLabeller &band = bands[i];
+
+        //Append the band's labels after those of the bands above it
+        int offset = parents.size();
+        for (unsigned int label = 0; label < band.parents.size(); label++) {
+            parents.push_back(band.parents[label] + offset);
+            stats.push_back(band.stats[label]);
+        }
+
+        //The last row of the band above touches the first row of this one
+        if (i > 0) {
+            joinTouchingRuns(bands[i - 1].prevRuns, prevOffset, band.firstRowRuns, offset);
+        }
+        prevOffset = offset;
+    }
+
+    collectBlobs(minArea, maxArea, maxBlobs);
+    return nBlobs;
+}
+
+//Buffers are only cleared so they are reused from frame to frame
+void BlobLabeller::clear() {
+    prevRuns.clear();
+    currRuns.clear();
+    firstRowRuns.clear();
+    parents.clear();
+    stats.clear();
+}
+
+//Turns the labelled runs into blobs, keeping up to maxBlobs whose area is within [minArea, maxArea]
+void BlobLabeller::collectBlobs(int minArea, int maxArea, int maxBlobs) {
+    blobs.clear();
+
+    //Fold the moments of every label into the root of its blob
+    for (unsigned int label = 0; label < parents.size(); label++) {
+        int root = findRoot(label);
+        if (root != (int)label) {
+            mergeStats(stats[root], stats[label]);
+        }
+    }
+
+    //Turn the roots into blobs, filtering by area
+    for (unsigned int label = 0; label < parents.size(); label++) {
+        if (parents[label] != (int)label) { continue; }
+
+        blobStats &s = stats[label];
+        if (s.area < minArea || s.area > maxArea) { continue; }
+
+        labelledBlob blob;
+        blob.area = s.area;
+        blob.centroid = ofVec2f(s.sumX / s.area, s.sumY / s.area);
+        blob.boundingRect = ofRectangle(s.minX, s.minY, s.maxX - s.minX + 1, s.maxY - s.minY + 1);
+        blobs.push_back(blob);
+    }
+
+    sort(blobs.begin(), blobs.end(), isLarger);
+    if ((int)blobs.size() > maxBlobs) {
+        blobs.resize(maxBlobs);
+    }
+
+    nBlobs = blobs.size();
+}
+
+//Joins the labels of runs on adjacent rows that touch. Labels are offset to where their band's labels were appended
+void BlobLabeller::joinTouchingRuns(const vector<run> &above, int aboveOffset, const vector<run> &below, int belowOffset) {
+    unsigned int aboveIndex = 0;
+    for (unsigned int i = 0; i < below.size(); i++) {
+        while (aboveIndex < above.size() && above[aboveIndex].end < below[i].start) { aboveIndex++; }
+
+        for (unsigned int j = aboveIndex; j < above.size() && above[j].start <= below[i].end; j++) {
+            join(above[j].label + aboveOffset, below[i].label + belowOffset);
+        }
+    }
+}
+
+int BlobLabeller::newLabel() {
+    blobStats s;
+    s.area = 0;
+    s.sumX = 0;
+    s.sumY = 0;
+    s.minX = INT_MAX;
+    s.minY = INT_MAX;
+    s.maxX = -1;
+    s.maxY = -1;
+
+    parents.push_back(parents.size());
+    stats.push_back(s);
+
+    return parents.size() - 1;
+}
+
+int BlobLabeller::findRoot(int label) {
+    while (parents[label] != label) {
+        //Path halving keeps the trees flat
+        parents[label] = parents[parents[label]];
+        label = parents[label];
+    }
+    return label;
+}
+
+//Marks two labels as the same blob and returns the root of the joined blob
+int BlobLabeller::join(int labelA, int labelB) {
+    int rootA = findRoot(labelA);
+    int rootB = findRoot(labelB);
+
+    if (rootA < rootB) {
+        parents[rootB] = rootA;
+        return rootA;
+    }
+    parents[rootA] = rootB;
+    return rootB;
+}
+
+//Records the run [start, end) on the given row and adds it to the moments of its label
+void BlobLabeller::addRun(int label, int row, int start, int end) {
+    run r;
+    r.start = start;
+    r.end = end;
+    r.label = label;
+    currRuns.push_back(r);
+
+    //Moments are taken about pixel centres
+    double length = end - start;
+    blobStats &s = stats[label];
+    s.area += length;
+    s.sumX += length * (start + end) / 2.0;
+    s.sumY += length * (row + 0.5);
+    if (start < s.minX) { s.minX = start; }
+    if (end - 1 > s.maxX) { s.maxX = end - 1; }
+    if (row < s.minY) { s.minY = row; }
+    if (row > s.maxY) { s.maxY = row; }
+}
+
+void BlobLabeller::mergeStats(blobStats &into, const blobStats &from) {
+    into.area += from.area;
+    into.sumX += from.sumX;
+    into.sumY += from.sumY;
+    if (from.minX < into.minX) { into.minX = from.minX; }
+    if (from.minY < into.minY) { into.minY = from.minY; }
+    if (from.maxX > into.maxX) { into.maxX = from.maxX; }
+    if (from.maxY > into.maxY) { into.maxY = from.maxY; }
+}
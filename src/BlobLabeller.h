@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ofMain.h"
+
+typedef struct labelledBlob {
+    float area;
+    ofVec2f centroid;
+    ofRectangle boundingRect;
+} labelledBlob;
+
+//Finds 8-connected blobs in a binary mask in a single pass over its rows
+//Only runs of foreground pixels and per-blob moments are kept, no contours are traced
+//A mask can also be labelled in horizontal bands, e.g. on different threads, and the bands merged afterwards
+class BlobLabeller
+{
+public:
+    BlobLabeller();
+    int findBlobs(unsigned char *mask, int width, int height, int minArea, int maxArea, int maxBlobs);
+    void labelBand(unsigned char *rows, int width, int firstRow, int numRows);
+    int mergeBands(vector<BlobLabeller> &bands, int minArea, int maxArea, int maxBlobs);
+
+    vector<labelledBlob> blobs;
+    int nBlobs;
+private:
+    typedef struct run {
+        int start;
+        int end;
+        int label;
+    } run;
+
+    typedef struct blobStats {
+        double area;
+        double sumX;
+        double sumY;
+        int minX, minY;
+        int maxX, maxY;
+    } blobStats;
+
+    void clear();
+    void collectBlobs(int minArea, int maxArea, int maxBlobs);
+    void joinTouchingRuns(const vector<run> &above, int aboveOffset, const vector<run> &below, int belowOffset);
+    int newLabel();
+    int findRoot(int label);
+    int join(int labelA, int labelB);
+    void addRun(int label, int row, int start, int end);
+    void mergeStats(blobStats &into, const blobStats &from);
+
+    vector<run> prevRuns;
+    vector<run> currRuns;
+    vector<run> firstRowRuns;
+    vector<int> parents;
+    vector<blobStats> stats;
+};
@@ -2,35 +2,43 @@
 #include <stdio.h>
 #include <time.h>
 
-//Actual webcam res is 640x480
-#define WEBCAM_X_RES 320
-#define WEBCAM_Y_RES 240
+//Resolution asked of the webcam, the one it actually gives is used from then on
+#define WEBCAM_X_RES 640
+#define WEBCAM_Y_RES 480
 
 #define BOX_EDGE_LENGTH 100.0
 
 #define CAMERA_DIST 195
 
-#define SPHERE_RADIUS 5
-#define SPHERE_SEPARATION 15
-
-#define DEGREES_PER_REVOLUTION 360.0
-
 #define COORD_SIZE 20
 
-#define ROTATION_SPEED 0.75
-
 #define H_MARGIN 1
 #define SV_MARGIN 5
 
-#define MIN_BLOB_AREA 10
-#define MAX_BLOB_AREA 1000
+//Blob areas at WEBCAM_X_RES x WEBCAM_Y_RES, scaled to the actual resolution
+#define MIN_BLOB_AREA 40
+#define MAX_BLOB_AREA 4000
 #define NUM_BLOBS 1
 
+#define MASK_OPACITY 0.8
+
 #define RESET_CALIBRATION_KEY 'C'
+#define KICK_SPHERES_KEY 'K'
+#define TOGGLE_PREDICTION_KEY 'P'
+
+//Estimated time (s) between light hitting the webcam sensor and grabFrame returning the frame
+#define CAPTURE_LATENCY 0.05
+
+#define KICK_SPEED 3.0
+
+#define STATS_X 10
+#define STATS_Y 25
+#define STATS_LINE_HEIGHT 15
 
 const ofColor calibrationCoordColour = ofColor(255, 100, 100);
 
-const int calibrationCoords[4][2] = {{(WEBCAM_X_RES / 4), (WEBCAM_Y_RES / 4)}, {(3 * WEBCAM_X_RES / 4), (WEBCAM_Y_RES / 4)}, {(3 * WEBCAM_X_RES / 4), (3 * WEBCAM_Y_RES / 4)}, {(WEBCAM_X_RES / 4), (3 * WEBCAM_Y_RES / 4)}};
+//As fractions of the width and height of the image on screen
+const float calibrationCoords[4][2] = {{0.25, 0.25}, {0.75, 0.25}, {0.75, 0.75}, {0.25, 0.75}};
 
 const ofColor crosshairColour = ofColor(100, 100, 255);
 
@@ -39,9 +47,12 @@ const GLfloat lightPosition[] = {200.0, 400.0, 0, 0.0};
 //--------------------------------------------------------------
 // Setup and main drawing loop
 //--------------------------------------------------------------
-BounceBox::BounceBox() :
-    box(BOX_EDGE_LENGTH)
-{
+BounceBox::BounceBox(int numVisionThreads, int shardCols, int shardRows) {
+    this->numVisionThreads = numVisionThreads;
+    this->shardCols = shardCols;
+    this->shardRows = shardRows;
+    tokenFound = false;
+    predicting = true;
 }
 
 void BounceBox::setup(){
@@ -66,32 +77,28 @@ void BounceBox::setup(){
     GLfloat ambient[] = {0.0f, 0.0f, 0.0f, 0.0f};
     glLightfv(GL_LIGHT0, GL_AMBIENT, ambient);
 
-    //Camera
-    camera.setTarget(box);
-	camera.setDistance(CAMERA_DIST);
-    camera.cacheMatrices();
+    //Boxes and their spheres, each box with a random rotation
+    srand((unsigned)time(0));
+    world.setup(shardCols, shardRows, BOX_EDGE_LENGTH, 0);
 
-    //Spheres
-    spheres.push_back(Sphere(&box, ofVec3f(-SPHERE_SEPARATION, 0, 0), SPHERE_RADIUS, ofColor(255, 0, 0)));
-    spheres.push_back(Sphere(&box, ofVec3f(0, 0, 0), SPHERE_RADIUS, ofColor(0, 255, 0)));
-    spheres.push_back(Sphere(&box, ofVec3f(SPHERE_SEPARATION, 0, 0), SPHERE_RADIUS, ofColor(0, 0, 255)));
+    //Camera, far enough back to see the whole grid of boxes
+    camera.setTarget(worldCentre);
+	camera.setDistance(CAMERA_DIST * world.getSize());
+    camera.cacheMatrices();
 
     //Webcam
     vidGrabber.listDevices();
     vidGrabber.initGrabber(WEBCAM_X_RES, WEBCAM_Y_RES);
-    webcamImage.setUseTexture(true);
-    webcamImage.allocate(WEBCAM_X_RES, WEBCAM_Y_RES);
+    webcamWidth = vidGrabber.getWidth();
+    webcamHeight = vidGrabber.getHeight();
+    visionPipeline.setup(webcamWidth, webcamHeight, numVisionThreads);
+    videoOverlay.allocate(webcamWidth, webcamHeight);
 
     //Colour calibration
     resetCalibration();
 
-    //Box rotation
-    srand((unsigned)time(0));
-    currRotation = ofVec3f(
-        (float)rand()/(float)RAND_MAX * DEGREES_PER_REVOLUTION,
-        (float)rand()/(float)RAND_MAX * DEGREES_PER_REVOLUTION,
-        (float)rand()/(float)RAND_MAX * DEGREES_PER_REVOLUTION
-    );
+    //State export for external processes, the app runs without it if shared memory isn't available
+    statePublisher.open();
 }
 
 //Updates are done inside draw
@@ -99,19 +106,32 @@ void BounceBox::update(){
 }
 
 void BounceBox::draw(){
-    //Get webcam image and display
+    //Get webcam image. It is not mirrored here, that is left to drawing
     vidGrabber.grabFrame();
-    webcamImage.setFromPixels(vidGrabber.getPixels(), WEBCAM_X_RES, WEBCAM_Y_RES);
-    webcamImage.mirror(false, true);
+
+    //Detect the token, and stream the webcam image to the GPU with the thresholded image packed into its alpha channel
+    //The vision threads write the packed image straight into the mapped buffer
+    //The camera is slower than the display, so in between new frames the last texture and token are kept
+    if (vidGrabber.isFrameNew()) {
+        frameCaptureTime = ofGetElapsedTimef() - CAPTURE_LATENCY;
+
+        unsigned char *packed = videoOverlay.beginFrame();
+        if (calibrating) {
+            visionPipeline.pack(vidGrabber.getPixels(), packed);
+        } else {
+            detectToken(packed);
+        }
+        videoOverlay.endFrame();
+    }
+
+    //Display webcam image, with the detected token overlaid
+    drawVideo();
 
     glDisable(GL_DEPTH_TEST);
-         webcamImage.draw(0,0, APP_WIDTH, APP_HEIGHT);
 	    ofDrawBitmapString("BounceBox", 10, 10);
+        drawStats();
     glEnable(GL_DEPTH_TEST);
 
-    //Convert to HSV for token detection
-    webcamImage.convertRgbToHsv();
-
     if (calibrating) {
         drawCalibrationCoord();
     } else {
@@ -133,16 +153,23 @@ void BounceBox::resetCalibration(){
     printf("Camera calibration:\n"
         "Position a uniquely-coloured token where the pink cross is drawn, then press any key. Repeat 3 more times.\n"
         "Then use the token to control the crosshair and press any key while the crosshair is over a sphere to push it.\n"
-        "Press Shift + C to reset the calibration.\n");
+        "Press Shift + C to reset the calibration.\n"
+        "Press Shift + K to kick all of the spheres.\n"
+        "Press Shift + P to toggle token prediction.\n");
     calibrating = true;
     currCalibrationCoord = 0;
+
+    //Positions from the old calibration shouldn't influence the new one
+    tokenPredictor.reset();
 }
 
 //Displays a pink cross where the calibration is going to take its next colour from
 void BounceBox::drawCalibrationCoord() {
     //Define rays in screen space and transform to world space
-    ofVec3f	coordVert[2] = {ofVec3f(2 * calibrationCoords[currCalibrationCoord][0], 2 * calibrationCoords[currCalibrationCoord][1] - COORD_SIZE, -1), ofVec3f(2 * calibrationCoords[currCalibrationCoord][0], 2 * calibrationCoords[currCalibrationCoord][1] + COORD_SIZE, 1)};
-	ofVec3f	coordHorz[2] = {ofVec3f(2 * calibrationCoords[currCalibrationCoord][0] - COORD_SIZE, 2 * calibrationCoords[currCalibrationCoord][1], -1), ofVec3f(2 * calibrationCoords[currCalibrationCoord][0] + COORD_SIZE, 2 * calibrationCoords[currCalibrationCoord][1], 1)};
+    float coordX = APP_WIDTH * calibrationCoords[currCalibrationCoord][0];
+    float coordY = APP_HEIGHT * calibrationCoords[currCalibrationCoord][1];
+    ofVec3f	coordVert[2] = {ofVec3f(coordX, coordY - COORD_SIZE, -1), ofVec3f(coordX, coordY + COORD_SIZE, 1)};
+	ofVec3f	coordHorz[2] = {ofVec3f(coordX - COORD_SIZE, coordY, -1), ofVec3f(coordX + COORD_SIZE, coordY, 1)};
 
     ofPushStyle();
         ofSetColor(calibrationCoordColour);
@@ -155,8 +182,10 @@ void BounceBox::drawCalibrationCoord() {
 //By getting the same colour from multiple coordinates we aim to minimise 
 //the impact of different lighting in different parts of the image
 void BounceBox::setCalibrationFromCoord() {
-    //Assume you're looking from the camera's POV - the origin is at the top-right, and positive is down and left
-    CvScalar s = cvGet2D(webcamImage.getCvImage(), calibrationCoords[currCalibrationCoord][1], calibrationCoords[currCalibrationCoord][0]);
+    //Calibration coordinates are in the mirrored image on screen, so flip them back for the webcam image
+    int calibrationX = webcamWidth - 1 - (int)(webcamWidth * calibrationCoords[currCalibrationCoord][0]);
+    int calibrationY = (int)(webcamHeight * calibrationCoords[currCalibrationCoord][1]);
+    CvScalar s = visionPipeline.getHsv(vidGrabber.getPixels(), calibrationX, calibrationY);
 
     printf("H=%f, S=%f, V=%f\n", s.val[0], s.val[1], s.val[2]);
 
@@ -179,124 +208,183 @@ void BounceBox::setCalibrationFromCoord() {
 // Bouncebox drawing
 //--------------------------------------------------------------
 void BounceBox::bounce() {
-    detectToken();
+    predictToken();
 
     camera.begin();
-        ofPushMatrix();
-            //Set up rotation
-            ofRotateX(currRotation.x);        
-            ofRotateY(currRotation.y);        
-            ofRotateZ(currRotation.z);        
-
-            //Detect clicks on spheres
-            if (clicked) {
-                findSphereClick();
-                clicked = false;
-            }
-
-            //Draw spheres
-            glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
+        //Detect clicks on spheres
+        if (clicked) {
+            findSphereClick();
+            clicked = false;
+        }
 
-            glEnable(GL_LIGHTING);
-            glEnable(GL_LIGHT0);
-                for(std::vector<Sphere>::iterator sphere = spheres.begin(); sphere != spheres.end(); ++sphere) {
-                    sphere->draw();
-                }
-            glDisable(GL_LIGHTING);
-            glDisable(GL_LIGHT0);
+        //Move spheres that are still awake and rotate the boxes, all boxes in parallel
+        world.step();
+        publishState();
 
-            box.draw();
-        ofPopMatrix();
+        //Draw all boxes and spheres
+        world.draw(lightPosition);
 
         //Draw crosshair, no rotation
         drawCrosshair();
     camera.end();
-
-    //Update box rotation
-    currRotation += ROTATION_SPEED;
-    if (currRotation.x >= DEGREES_PER_REVOLUTION || currRotation.x <= -DEGREES_PER_REVOLUTION) {
-        currRotation.x = 0;
-    }
-    if (currRotation.y >= DEGREES_PER_REVOLUTION || currRotation.y <= -DEGREES_PER_REVOLUTION) {
-        currRotation.y = 0;
-    }
-    if (currRotation.z >= DEGREES_PER_REVOLUTION || currRotation.z <= -DEGREES_PER_REVOLUTION) {
-        currRotation.z = 0;
-    }
 }
 
 //Determines the position of the coloured token
-void BounceBox::detectToken() {
-    //Threshold to get only token
-    IplImage *imgThreshed = cvCreateImage(cvGetSize(webcamImage.getCvImage()), 8, 1);
-    cvInRangeS(webcamImage.getCvImage(), cvScalar(minH - H_MARGIN, minS - SV_MARGIN, minV - SV_MARGIN), cvScalar(maxH + H_MARGIN, maxS + SV_MARGIN, maxV + SV_MARGIN), imgThreshed);
-
-    //Convert back to OF image
-    ofxCvGrayscaleImage imgThreshedOF;
-    imgThreshedOF.allocate(WEBCAM_X_RES, WEBCAM_Y_RES);
-    imgThreshedOF = imgThreshed;
-    imgThreshedOF.erode();
-
-    //Locate token
-    contourFinder.findContours(imgThreshedOF, MIN_BLOB_AREA, MAX_BLOB_AREA, NUM_BLOBS, false);
-    for (int i = 0; i < contourFinder.nBlobs; i++) {
-        tokenPos = contourFinder.blobs.at(i).boundingRect.getCenter();
-        tokenPos *= 2;
+//Also packs the webcam image and thresholded image into packed, unless it is NULL
+void BounceBox::detectToken(unsigned char *packed) {
+    //Threshold to get only token and find its blob, spread across the vision threads
+    float areaScale = (float)(webcamWidth * webcamHeight) / (WEBCAM_X_RES * WEBCAM_Y_RES);
+    visionPipeline.process(vidGrabber.getPixels(), packed,
+        cvScalar(minH - H_MARGIN, minS - SV_MARGIN, minV - SV_MARGIN), cvScalar(maxH + H_MARGIN, maxS + SV_MARGIN, maxV + SV_MARGIN),
+        MIN_BLOB_AREA * areaScale, MAX_BLOB_AREA * areaScale, NUM_BLOBS);
+
+    //Locate token from the centroid of the largest blob, which is sub-pixel accurate
+    //The webcam image isn't mirrored, so mirror the position to match the screen
+    tokenFound = (visionPipeline.nBlobs > 0);
+    for (int i = 0; i < visionPipeline.nBlobs; i++) {
+        ofVec2f centroid = visionPipeline.blobs.at(i).centroid;
+        tokenPos = ofVec3f(
+            (webcamWidth - centroid.x) * APP_WIDTH / webcamWidth,
+            centroid.y * APP_HEIGHT / webcamHeight,
+            0
+        );
     }
+}
 
-    //Overlay thresholded image over webcam image to indicate detected token
+//Draws the webcam image mirrored, with the thresholded image overlaid to indicate the detected token
+void BounceBox::drawVideo() {
     glDisable(GL_DEPTH_TEST);
-        ofPushStyle();
-            glColor4f(1.0, 1.0, 1.0, 0.8);
-            imgThreshedOF.draw(0, 0, APP_WIDTH, APP_HEIGHT);
-        ofPopStyle();
+        videoOverlay.draw(0, 0, APP_WIDTH, APP_HEIGHT, calibrating ? 0 : MASK_OPACITY);
     glEnable(GL_DEPTH_TEST);
 }
 
+//Estimates where the token is at display time to hide the capture and detection delay
+//Sets displayTokenPos, which is what the crosshair and clicks use
+void BounceBox::predictToken() {
+    //Only feed the predictor new frames, repeated frames would look like the token had stopped
+    if (tokenFound && vidGrabber.isFrameNew()) {
+        tokenPredictor.addSample(ofVec2f(tokenPos.x, tokenPos.y), frameCaptureTime);
+    }
+
+    //The frame being drawn is shown at the next vertical sync
+    float displayTime = ofGetElapsedTimef() + ofGetLastFrameTime();
+
+    if (predicting && tokenFound && tokenPredictor.hasSamples()) {
+        ofVec2f predicted = tokenPredictor.predict(displayTime);
+        displayTokenPos = ofVec3f(predicted.x, predicted.y, 0);
+    } else {
+        //Still measure the latency so it can be compared with prediction on
+        //A lost token stays where it was last seen rather than being extrapolated
+        tokenPredictor.predict(displayTime);
+        displayTokenPos = tokenPos;
+    }
+}
+
 //When a key is pressed, uses the token position to detect which sphere has been clicked and where
 void BounceBox::findSphereClick() {
     ofVec3f clickLine[2];
     //Transform position of token from screen to world using camera.screenToWorld
-    //This assumes screen is currently showing camera's POV, but we have added extra rotation
-    //Therefore we must apply our custom rotation to the position returned by screenToWorld
-    
-    tokenPos.z = -1;
-    clickLine[0] = camera.screenToWorld(tokenPos);
-    clickLine[0] = clickLine[0].rotate(-currRotation.x, ofVec3f(1,0,0)).rotate(-currRotation.y, ofVec3f(0,1,0)).rotate(-currRotation.z, ofVec3f(0,0,1));
+    //The world routes the click to the box under the crosshair, which undoes its own position and rotation
+
+    ofVec3f clickPos = displayTokenPos;
 
-    tokenPos.z = 1;
-    clickLine[1] = camera.screenToWorld(tokenPos);
-    clickLine[1] = clickLine[1].rotate(-currRotation.x, ofVec3f(1,0,0)).rotate(-currRotation.y, ofVec3f(0,1,0)).rotate(-currRotation.z, ofVec3f(0,0,1));
+    clickPos.z = -1;
+    clickLine[0] = camera.screenToWorld(clickPos);
 
-    //Get direction of clickLine
-    ofVec3f clickLineDir = clickLine[1] - clickLine[0];
+    clickPos.z = 1;
+    clickLine[1] = camera.screenToWorld(clickPos);
 
-    float closestIntersectionDist = 0;
-    Sphere *closestIntersectionSphere = NULL;
+    world.click(clickLine[0], clickLine[1]);
+}
+
+//--------------------------------------------------------------
+// Stats
+//--------------------------------------------------------------
+void BounceBox::drawStats() {
+    int numActive = world.getNumActive();
+    int numSleeping = world.getNumSpheres() - numActive;
+    ofDrawBitmapString("Active: " + ofToString(numActive) + " Sleeping: " + ofToString(numSleeping), STATS_X, STATS_Y);
 
-    //Check intersection of click ray with each sphere
-    for(std::vector<Sphere>::iterator sphere = spheres.begin(); sphere != spheres.end(); ++sphere) {
-        float clickToSphere = sphere->findRayIntersection(clickLine[0], clickLineDir);
+    ofDrawBitmapString("Prediction: " + string(predicting ? "on" : "off")
+        + " Latency: " + (tokenPredictor.hasSamples() ? ofToString(tokenPredictor.getLatency() * 1000, 0) + "ms" : "-")
+        + " Lead: " + (tokenPredictor.hasSamples() ? ofToString(predicting ? tokenPredictor.getLead() : 0, 1) + "px" : "-"), STATS_X, STATS_Y + STATS_LINE_HEIGHT);
+
+    ofDrawBitmapString("Vision: " + ofToString(visionPipeline.getNumThreads()) + " threads "
+        + ofToString(visionPipeline.getProcessTime() * 1000, 1) + "ms", STATS_X, STATS_Y + 2 * STATS_LINE_HEIGHT);
+
+    ofDrawBitmapString("Boxes: " + ofToString(world.getNumShards()) + " on " + ofToString(world.getNumThreads()) + " threads "
+        + ofToString(world.getStepTime() * 1000, 1) + "ms", STATS_X, STATS_Y + 3 * STATS_LINE_HEIGHT);
+}
 
-        if (clickToSphere > 0) {
-            //Check if this is the closest sphere to the click point
-            if (closestIntersectionSphere == NULL || clickToSphere < closestIntersectionDist) {
-                closestIntersectionDist = clickToSphere;
-                closestIntersectionSphere = &(*sphere);
+//--------------------------------------------------------------
+// State export
+//--------------------------------------------------------------
+static sharedVec3 toSharedVec3(ofVec3f v) {
+    sharedVec3 shared = {v.x, v.y, v.z};
+    return shared;
+}
+
+static void toSharedColor(ofColor color, uint8_t *shared) {
+    shared[0] = color.r;
+    shared[1] = color.g;
+    shared[2] = color.b;
+    shared[3] = color.a;
+}
+
+//Writes this frame's boxes, spheres, token and bounces straight into the shared memory ring
+void BounceBox::publishState() {
+    sharedFrame *frame = statePublisher.beginFrame();
+    if (frame != NULL) {
+        frame->time = ofGetElapsedTimef();
+        frame->tokenFound = tokenFound;
+        frame->tokenPos = toSharedVec3(tokenPos);
+        frame->displayTokenPos = toSharedVec3(displayTokenPos);
+        frame->numShards = 0;
+        frame->numSpheres = 0;
+        frame->numBounces = 0;
+    }
+
+    for (int i = 0; i < world.getNumShards(); i++) {
+        BoxShard &shard = world.getShard(i);
+        Box &box = shard.getBox();
+
+        if (frame != NULL && frame->numShards < SHARED_STATE_MAX_SHARDS) {
+            sharedShard &sharedBox = frame->shards[frame->numShards++];
+            sharedBox.pos = toSharedVec3(shard.getPosition());
+            sharedBox.rotation = toSharedVec3(shard.getRotation());
+
+            vector<Sphere> &spheres = shard.getSpheres();
+            for(std::vector<Sphere>::iterator sphere = spheres.begin(); sphere != spheres.end() && frame->numSpheres < SHARED_STATE_MAX_SPHERES; ++sphere) {
+                sharedSphere &shared = frame->spheres[frame->numSpheres++];
+                shared.pos = toSharedVec3(sphere->getCentre());
+                shared.vel = toSharedVec3(sphere->getVelocity());
+                toSharedColor(sphere->getColor(), shared.color);
+                shared.awake = sphere->isAwake();
+                shared.shard = i;
+            }
+
+            vector<bounceDetails> &bounces = box.getBounces();
+            for(std::vector<bounceDetails>::iterator bounce = bounces.begin(); bounce != bounces.end() && frame->numBounces < SHARED_STATE_MAX_BOUNCES; ++bounce) {
+                sharedBounce &shared = frame->bounces[frame->numBounces++];
+                shared.faceIndex = bounce->faceIndex;
+                shared.shard = i;
+                shared.hitPt = toSharedVec3(bounce->hitPt);
+                toSharedColor(bounce->color, shared.color);
             }
         }
+
+        box.clearBounces();
     }
-    
-    //Push the sphere that was closest to the click point
-    if (closestIntersectionSphere != NULL) {
-        closestIntersectionSphere->click(clickLine[0] + (clickLineDir.getNormalized().scale(closestIntersectionDist)), clickLine[0]);
+
+    if (frame != NULL) {
+        statePublisher.endFrame();
     }
 }
 
 void BounceBox::drawCrosshair(){
     //Define rays in screen space and transform to world space
-    ofVec3f	crosshairX[2] = {camera.screenToWorld(ofVec3f(tokenPos.x, 0, -1)), camera.screenToWorld(ofVec3f(tokenPos.x, ofGetHeight(), 1))};
-	ofVec3f	crosshairY[2] = {camera.screenToWorld(ofVec3f(0, tokenPos.y, -1)), camera.screenToWorld(ofVec3f(ofGetWidth(), tokenPos.y, 1))};
+    ofVec3f	crosshairX[2] = {camera.screenToWorld(ofVec3f(displayTokenPos.x, 0, -1)), camera.screenToWorld(ofVec3f(displayTokenPos.x, ofGetHeight(), 1))};
+	ofVec3f	crosshairY[2] = {camera.screenToWorld(ofVec3f(0, displayTokenPos.y, -1)), camera.screenToWorld(ofVec3f(ofGetWidth(), displayTokenPos.y, 1))};
 
     //Draw
     ofPushStyle();
@@ -314,6 +402,10 @@ void BounceBox::keyPressed(int key){
         setCalibrationFromCoord();
     } else if (key == RESET_CALIBRATION_KEY) {
         resetCalibration();
+    } else if (key == KICK_SPHERES_KEY) {
+        world.kick(KICK_SPEED);
+    } else if (key == TOGGLE_PREDICTION_KEY) {
+        predicting = !predicting;
     } else {
         clicked = true;
     }
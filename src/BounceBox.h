@@ -2,15 +2,18 @@
 
 #include "ofMain.h"
 #include "ofxOpenCv.h"
-#include "Sphere.h"
-#include "Box.h"
+#include "BoxWorld.h"
+#include "VisionPipeline.h"
+#include "TokenPredictor.h"
+#include "StatePublisher.h"
+#include "VideoOverlay.h"
 
 #define APP_WIDTH 640
 #define APP_HEIGHT 480
 
 class BounceBox : public ofBaseApp{
 	public:
-        BounceBox();
+        BounceBox(int numVisionThreads, int shardCols, int shardRows);
        	void setup();
 		void update();
 		void draw();
@@ -28,25 +31,40 @@ class BounceBox : public ofBaseApp{
         void resetCalibration();
         void setCalibrationFromCoord();
         void drawCrosshair();
-        void detectToken();
+        void detectToken(unsigned char *packed);
         void findSphereClick();
         void bounce();
         void drawCalibrationCoord();
+        void drawStats();
+        void predictToken();
+        void publishState();
+        void drawVideo();
 
         ofEasyCam camera;
 
-        Box box;
-        vector<Sphere> spheres;
+        BoxWorld world;
+        ofNode worldCentre;
+        int shardCols;
+        int shardRows;
 
         bool clicked;
 
-        ofVec3f currRotation;
-
         ofVideoGrabber vidGrabber;
-        ofxCvColorImage webcamImage;
+        VisionPipeline visionPipeline;
+        int numVisionThreads;
+        int webcamWidth;
+        int webcamHeight;
+        VideoOverlay videoOverlay;
 
-        ofxCvContourFinder contourFinder;
 		ofVec3f tokenPos;
+        bool tokenFound;
+        float frameCaptureTime;
+
+        TokenPredictor tokenPredictor;
+        bool predicting;
+        ofVec3f displayTokenPos;
+
+        StatePublisher statePublisher;
 
         bool calibrating;
         int minH, minS, minV;
@@ -13,87 +13,72 @@
 
 #define TRANSPARENCY_THRESHOLD 0.05
 
-//Create the meshes that make up the box
-//The box is made up of a vector of faces
-//Each face is made up of a vector of rows
-//Each row is an ofMesh
+#define NUM_POINTS_PER_SIDE (NUM_SQUARES_PER_SIDE + 1)
+#define NUM_STRIP_VERTICES (2 * NUM_POINTS_PER_SIDE)
+
+#define WIREFRAME_ALPHA 32
+
+//Index into gridPoints of the given corner of the squares on a face
+static int getGridIndex(int faceIndex, int col, int row) {
+    return (faceIndex * NUM_POINTS_PER_SIDE + row) * NUM_POINTS_PER_SIDE + col;
+}
+
+//Each row of squares is a triangle strip that zigzags between the bottom and top of the row,
+//so its vertex i is corner i / 2 along the bottom (i even) or top (i odd) of the row
+static int getStripGridIndex(int faceIndex, int rowIndex, int stripIndex) {
+    return getGridIndex(faceIndex, stripIndex / 2, rowIndex + stripIndex % 2);
+}
+
+static int getStripColorIndex(int faceIndex, int rowIndex, int stripIndex) {
+    return (faceIndex * NUM_SQUARES_PER_SIDE + rowIndex) * NUM_STRIP_VERTICES + stripIndex;
+}
+
+//Work out where the corners of the squares that make up the box are, and which of them the wireframe joins
+//Each face is a grid of squares, made up of a triangle strip for each row
 Box::Box(float sideLength) {
     this->sideLength = sideLength;
     squareSideLength = sideLength / NUM_SQUARES_PER_SIDE;
-    
-    //Loop through for each face
+
+    //Place each face such that they form a box and so that the hit methods work correctly
     for (int k = 0; k < NUM_FACES_ON_BOX; k++) {
-        vector<ofMesh> face;
+        ofVec3f faceOffset(-sideLength / 2, -sideLength / 2, sideLength / 2);
+        if (k == BACK || k == RIGHT || k == TOP) {
+            faceOffset.z = -sideLength / 2;
+        }
 
-        //Loop through each row on a face
-        for (int i = 0; i < NUM_SQUARES_PER_SIDE; i++) {
-            ofMesh row;
-            row.setMode(OF_PRIMITIVE_TRIANGLE_STRIP);
-
-            float currYDisp = i * squareSideLength;
-            
-            int currIndex = 0;
-        
-            //Start row
-            row.addIndex(ofIndexType(currIndex++));
-            row.addColor(ofColor(255, 255, 255, 255));
-            row.addVertex(ofVec3f(0, currYDisp, 0));
-            row.addIndex(ofIndexType(currIndex++));
-            row.addColor(ofColor(255, 255, 255, 255));
-            row.addVertex(ofVec3f(0, currYDisp + squareSideLength, 0));
-
-            //Create row
-            for (int j = 1; j <= NUM_SQUARES_PER_SIDE; j++) {
-                row.addIndex(ofIndexType(currIndex++));
-                row.addColor(ofColor(255, 255, 255, 255));
-                row.addVertex(ofVec3f(j * squareSideLength, currYDisp, 0));
-                row.addIndex(ofIndexType(currIndex++));
-                row.addColor(ofColor(255, 255, 255, 255));
-                row.addVertex(ofVec3f(j * squareSideLength, currYDisp + squareSideLength, 0));
+        for (int i = 0; i < NUM_POINTS_PER_SIDE; i++) {
+            for (int j = 0; j < NUM_POINTS_PER_SIDE; j++) {
+                ofVec3f gridPoint = ofVec3f(j * squareSideLength, i * squareSideLength, 0) + faceOffset;
+                if (k == LEFT || k == RIGHT) {
+                    gridPoint.rotate(-90, ofVec3f(0, 1, 0));
+                } else if (k == TOP || k == BOTTOM) {
+                    gridPoint.rotate(90, ofVec3f(1, 0, 0));
+                }
+                gridPoints.push_back(gridPoint);
+            }
+        }
+
+        //The wireframe is the edges of every triangle: the sides of each square and the diagonal the strip splits it along
+        for (int i = 0; i < NUM_POINTS_PER_SIDE; i++) {
+            for (int j = 0; j < NUM_POINTS_PER_SIDE; j++) {
+                if (j < NUM_SQUARES_PER_SIDE) {
+                    wireIndices.push_back(getGridIndex(k, j, i));
+                    wireIndices.push_back(getGridIndex(k, j + 1, i));
+                }
+                if (i < NUM_SQUARES_PER_SIDE) {
+                    wireIndices.push_back(getGridIndex(k, j, i));
+                    wireIndices.push_back(getGridIndex(k, j, i + 1));
+                }
+                if (i < NUM_SQUARES_PER_SIDE && j < NUM_SQUARES_PER_SIDE) {
+                    wireIndices.push_back(getGridIndex(k, j, i + 1));
+                    wireIndices.push_back(getGridIndex(k, j + 1, i));
+                }
             }
-            face.push_back(row);
         }
-        faces.push_back(face);
     }
-}
 
-//Does the setup for and calls the drawFace method for each face
-//such that they form a box and so that the hit methods work correctly
-void Box::customDraw()
-{
-    ofPushMatrix();
-        ofTranslate(-sideLength / 2, -sideLength / 2, sideLength / 2);
-        drawFace(FRONT);
-    ofPopMatrix();
-
-    ofPushMatrix();
-        ofTranslate(-sideLength / 2, -sideLength / 2, -sideLength / 2);
-        drawFace(BACK);
-    ofPopMatrix();
-
-    ofPushMatrix();
-        ofRotateY(-90);
-        ofTranslate(-sideLength / 2, -sideLength / 2, -sideLength / 2);
-        drawFace(RIGHT);
-    ofPopMatrix();
-
-    ofPushMatrix();
-        ofRotateY(-90);
-        ofTranslate(-sideLength / 2, -sideLength / 2, sideLength / 2);
-        drawFace(LEFT);
-    ofPopMatrix();
-
-    ofPushMatrix();
-        ofRotateX(90);
-        ofTranslate(-sideLength / 2, -sideLength / 2, -sideLength / 2);
-        drawFace(TOP);
-    ofPopMatrix();
-
-    ofPushMatrix();
-        ofRotateX(90);
-        ofTranslate(-sideLength / 2, -sideLength / 2, sideLength / 2);
-        drawFace(BOTTOM);
-    ofPopMatrix();
+    worldGridPoints.resize(gridPoints.size());
+    stripColors.resize(NUM_FACES_ON_BOX * NUM_SQUARES_PER_SIDE * NUM_STRIP_VERTICES);
 }
 
 //Returns true and frees a hitDetail struct if it is almost transparent
@@ -108,53 +93,105 @@ bool isAlmostTransparent(HitDetails hit) {
     return almostTransparent;
 }
 
-//Draws up a face of the box. Matrices to position face must be
-//set up before calling this method
-void Box::drawFace(int faceIndex) {
-    vector<ofMesh> face = faces.at(faceIndex);
+//Fades the hits a little, should be called once per frame
+void Box::fadeHits() {
+    for(std::vector<HitDetails>::iterator hit = hits.begin(); hit != hits.end(); ++hit) {
+        (*hit)->color.a *= 0.99;
+    }
+
+    //Delete hits if they are almost transparent
+    hits.erase(remove_if(hits.begin(), hits.end(), isAlmostTransparent), hits.end());
+}
+
+//Number of vertices buildGeometry writes for the wireframe, two per line
+int Box::getNumWireVertices() {
+    return wireIndices.size();
+}
+
+//Works out the wireframe and the coloured squares where the box has been hit in world coordinates,
+//for the box translated to position and then rotated by ofRotateX, ofRotateY and ofRotateZ
+//Writes getNumWireVertices() vertices to wireVertices and appends the squares to the fill arrays as
+//triangles with 4 colour components per vertex, so that any number of boxes can be drawn together
+void Box::buildGeometry(ofVec3f position, ofVec3f rotation, ofVec3f *wireVertices, vector<ofVec3f> &fillVertices, vector<GLubyte> &fillColors) {
+    ofVec3f xAxis = ofVec3f(1, 0, 0).rotate(rotation.z, ofVec3f(0, 0, 1)).rotate(rotation.y, ofVec3f(0, 1, 0)).rotate(rotation.x, ofVec3f(1, 0, 0));
+    ofVec3f yAxis = ofVec3f(0, 1, 0).rotate(rotation.z, ofVec3f(0, 0, 1)).rotate(rotation.y, ofVec3f(0, 1, 0)).rotate(rotation.x, ofVec3f(1, 0, 0));
+    ofVec3f zAxis = ofVec3f(0, 0, 1).rotate(rotation.z, ofVec3f(0, 0, 1)).rotate(rotation.y, ofVec3f(0, 1, 0)).rotate(rotation.x, ofVec3f(1, 0, 0));
+
+    for (unsigned int i = 0; i < gridPoints.size(); i++) {
+        worldGridPoints[i] = position + xAxis * gridPoints[i].x + yAxis * gridPoints[i].y + zAxis * gridPoints[i].z;
+    }
+
+    for (unsigned int i = 0; i < wireIndices.size(); i++) {
+        wireVertices[i] = worldGridPoints[wireIndices[i]];
+    }
 
-    //Start by drawing all of the coloured squares that represents where the box has been hit
+    if (hits.empty()) {
+        return;
+    }
 
-    //Set all colours to transparent black
-    for(int i = 0; i < NUM_SQUARES_PER_SIDE; i++) {
-        vector<ofIndexType> rowIndices = face.at(i).getIndices();
-        for(std::vector<ofIndexType>::iterator index = rowIndices.begin(); index != rowIndices.end(); ++index) {
-            face.at(i).setColor(*index, ofColor(0, 0, 0, 0));
+    //Set all colours on the hit faces to transparent black
+    bool faceHit[NUM_FACES_ON_BOX] = {false};
+    for(std::vector<HitDetails>::iterator hit = hits.begin(); hit != hits.end(); ++hit) {
+        faceHit[(*hit)->faceIndex] = true;
+    }
+    for (int k = 0; k < NUM_FACES_ON_BOX; k++) {
+        if (faceHit[k]) {
+            fill(stripColors.begin() + getStripColorIndex(k, 0, 0), stripColors.begin() + getStripColorIndex(k + 1, 0, 0), ofColor(0, 0, 0, 0));
         }
     }
 
     //Set the colours where hits have occurred
     for(std::vector<HitDetails>::iterator hit = hits.begin(); hit != hits.end(); ++hit) {
-        if ((*hit)->faceIndex == faceIndex) {
-            
-            face.at((*hit)->rowIndex).setColor((*hit)->colIndex, (*hit)->color);
-
-            (*hit)->color.a *= 0.99;
-        }
+        stripColors[getStripColorIndex((*hit)->faceIndex, (*hit)->rowIndex, (*hit)->colIndex)] = (*hit)->color;
     }
 
-	glDisable(GL_DEPTH_TEST);
-        //Redraw the now-coloured box
-        for(std::vector<ofMesh>::iterator row = face.begin(); row != face.end(); ++row) {
-            row->draw();
+    //Only the triangles of each strip with some colour are visible
+    for (int k = 0; k < NUM_FACES_ON_BOX; k++) {
+        if (!faceHit[k]) {
+            continue;
         }
 
-        //Make the box wireframe a transparent white by setting all colours to this colour
-        for(std::vector<ofMesh>::iterator row = face.begin(); row != face.end(); ++row) {
-            vector<ofIndexType> rowIndices = row->getIndices();
-            for(std::vector<ofIndexType>::iterator index = rowIndices.begin(); index != rowIndices.end(); ++index) {
-                row->setColor(*index, ofColor(255, 255, 255, 32));
+        for (int i = 0; i < NUM_SQUARES_PER_SIDE; i++) {
+            for (int j = 0; j + 2 < NUM_STRIP_VERTICES; j++) {
+                ofColor *triangleColors = &stripColors[getStripColorIndex(k, i, j)];
+                if (triangleColors[0].a <= 0 && triangleColors[1].a <= 0 && triangleColors[2].a <= 0) {
+                    continue;
+                }
+
+                for (int v = 0; v < 3; v++) {
+                    fillVertices.push_back(worldGridPoints[getStripGridIndex(k, i, j + v)]);
+                    fillColors.push_back((GLubyte)triangleColors[v].r);
+                    fillColors.push_back((GLubyte)triangleColors[v].g);
+                    fillColors.push_back((GLubyte)triangleColors[v].b);
+                    fillColors.push_back((GLubyte)triangleColors[v].a);
+                }
             }
         }
+    }
+}
 
-        //Draw wireframe
-        for(std::vector<ofMesh>::iterator row = face.begin(); row != face.end(); ++row) {
-            row->drawWireframe();
+//Draws boxes from buildGeometry with one draw call for all of the coloured squares and one for all of the wireframes
+void Box::drawGeometry(vector<ofVec3f> &wireVertices, vector<ofVec3f> &fillVertices, vector<GLubyte> &fillColors) {
+    ofPushStyle();
+	glDisable(GL_DEPTH_TEST);
+    glEnableClientState(GL_VERTEX_ARRAY);
+        if (!fillVertices.empty()) {
+            glEnableClientState(GL_COLOR_ARRAY);
+                glVertexPointer(3, GL_FLOAT, sizeof(ofVec3f), &fillVertices[0].x);
+                glColorPointer(4, GL_UNSIGNED_BYTE, 0, &fillColors[0]);
+                glDrawArrays(GL_TRIANGLES, 0, fillVertices.size());
+            glDisableClientState(GL_COLOR_ARRAY);
         }
-	glEnable(GL_DEPTH_TEST);
 
-    //Delete hits if they are almost transparent
-    hits.erase(remove_if(hits.begin(), hits.end(), isAlmostTransparent), hits.end());
+        //Draw wireframe in a transparent white
+        if (!wireVertices.empty()) {
+            ofSetColor(255, 255, 255, WIREFRAME_ALPHA);
+            glVertexPointer(3, GL_FLOAT, sizeof(ofVec3f), &wireVertices[0].x);
+            glDrawArrays(GL_LINES, 0, wireVertices.size());
+        }
+    glDisableClientState(GL_VERTEX_ARRAY);
+	glEnable(GL_DEPTH_TEST);
+    ofPopStyle();
 }
 
 //Determines the square where a hit occurred and accordingly sets up the arguments for createHits
@@ -177,19 +214,44 @@ void Box::hit(bool hitX, bool hitY, bool hitZ, ofVec3f hitPt, ofColor color) {
 
     //Create hit on the appropriate face
     color.a = 255;
+    int faceIndex = -1;
     if (hitZ && hitPt.z > 0) {
+        faceIndex = FRONT;
         createHits(FRONT, hitYSquare, hitXSquare, ofColor(color));
     } else if (hitZ && hitPt.z < 0) {
+        faceIndex = BACK;
         createHits(BACK, hitYSquare, hitXSquare, ofColor(color));
     } else if (hitX && hitPt.x > 0) {
+        faceIndex = RIGHT;
         createHits(RIGHT, hitYSquare, hitZSquare, ofColor(color));
     } else if (hitX && hitPt.x < 0) {
+        faceIndex = LEFT;
         createHits(LEFT, hitYSquare, hitZSquare, ofColor(color));
     } else if (hitY && hitPt.y > 0) {
+        faceIndex = TOP;
         createHits(TOP, hitZSquare, hitXSquare, ofColor(color));
     } else if (hitY && hitPt.y < 0) {
+        faceIndex = BOTTOM;
         createHits(BOTTOM, hitZSquare, hitXSquare, ofColor(color));
     }
+
+    //Remember the bounce until the owner has collected it
+    if (faceIndex >= 0) {
+        bounceDetails bounce;
+        bounce.faceIndex = faceIndex;
+        bounce.hitPt = hitPt;
+        bounce.color = color;
+        bounces.push_back(bounce);
+    }
+}
+
+//Returns the bounces since clearBounces was last called
+vector<bounceDetails> &Box::getBounces() {
+    return bounces;
+}
+
+void Box::clearBounces() {
+    bounces.clear();
 }
 
 //Creates and adds a hitDetails struct for a hit on the given face and rows
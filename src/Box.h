@@ -13,20 +13,40 @@ typedef struct hitDetails {
 } hitDetails;
 typedef hitDetails *HitDetails;
 
+typedef struct bounceDetails {
+    int faceIndex;
+    ofVec3f hitPt;
+    ofColor color;
+} bounceDetails;
+
 class Box : public ofNode
 {
 public:
     Box(float sideLength);
-	void customDraw();
+    void fadeHits();
+    int getNumWireVertices();
+    void buildGeometry(ofVec3f position, ofVec3f rotation, ofVec3f *wireVertices, vector<ofVec3f> &fillVertices, vector<GLubyte> &fillColors);
+    static void drawGeometry(vector<ofVec3f> &wireVertices, vector<ofVec3f> &fillVertices, vector<GLubyte> &fillColors);
     float getSideLength();
     void hit(bool hitX, bool hitY, bool hitZ, ofVec3f hitPt, ofColor color);
+    vector<bounceDetails> &getBounces();
+    void clearBounces();
 private:
-    void drawFace(int faceIndex);
     HitDetails createHitDetails(int faceIndex, int rowIndex, int colIndex, ofColor color);
     void createHits(int faceIndex, int rowSquare, int colSquare, ofColor color);
 
     float sideLength;
     float squareSideLength;
-    vector< vector<ofMesh> > faces;
+
+    //Corners of the squares on each face in box coordinates, and the same in world coordinates once built
+    vector<ofVec3f> gridPoints;
+    vector<ofVec3f> worldGridPoints;
+
+    //Pairs of grid points joined by the wireframe
+    vector<int> wireIndices;
+
+    //Colour of each vertex of the triangle strip along each row of squares on each face
+    vector<ofColor> stripColors;
     vector< HitDetails > hits;
+    vector<bounceDetails> bounces;
 };
@@ -0,0 +1,215 @@
+#include "BoxShard.h"
+
+#define SPHERE_RADIUS 5
+#define SPHERE_SEPARATION 15
+
+#define DEGREES_PER_REVOLUTION 360.0
+
+#define ROTATION_SPEED 0.75
+
+BoxShard::BoxShard(ofVec3f position, float boxEdgeLength) :
+    box(boxEdgeLength)
+{
+    this->position = position;
+
+    //Half the diagonal of the box, so the box is inside this sphere whatever its rotation
+    //Sphere centres only stay inside the box, so a sphere in a corner can stick out by its radius
+    boundingRadius = boxEdgeLength * sqrt(3.0) / 2 + SPHERE_RADIUS;
+
+    //Reserve so that the active set's pointers into spheres stay valid
+    spheres.reserve(3);
+    spheres.push_back(Sphere(&box, ofVec3f(-SPHERE_SEPARATION, 0, 0), SPHERE_RADIUS, ofColor(255, 0, 0)));
+    spheres.push_back(Sphere(&box, ofVec3f(0, 0, 0), SPHERE_RADIUS, ofColor(0, 255, 0)));
+    spheres.push_back(Sphere(&box, ofVec3f(SPHERE_SEPARATION, 0, 0), SPHERE_RADIUS, ofColor(0, 0, 255)));
+
+    currRotation = ofVec3f(
+        (float)rand()/(float)RAND_MAX * DEGREES_PER_REVOLUTION,
+        (float)rand()/(float)RAND_MAX * DEGREES_PER_REVOLUTION,
+        (float)rand()/(float)RAND_MAX * DEGREES_PER_REVOLUTION
+    );
+}
+
+//Moves the spheres that are still awake and rotates the box
+//Only touches this shard, so it is safe to call for different shards on different threads
+void BoxShard::step() {
+    box.fadeHits();
+
+    //Spheres at rest are dropped from the active set and cost nothing here
+    vector<Sphere *>::iterator active = activeSpheres.begin();
+    while (active != activeSpheres.end()) {
+        if ((*active)->updatePos()) {
+            ++active;
+        } else {
+            active = activeSpheres.erase(active);
+        }
+    }
+
+    currRotation += ROTATION_SPEED;
+    if (currRotation.x >= DEGREES_PER_REVOLUTION || currRotation.x <= -DEGREES_PER_REVOLUTION) {
+        currRotation.x = 0;
+    }
+    if (currRotation.y >= DEGREES_PER_REVOLUTION || currRotation.y <= -DEGREES_PER_REVOLUTION) {
+        currRotation.y = 0;
+    }
+    if (currRotation.z >= DEGREES_PER_REVOLUTION || currRotation.z <= -DEGREES_PER_REVOLUTION) {
+        currRotation.z = 0;
+    }
+}
+
+//Sets up the matrices so that drawing is in the shard's rotated box coordinates
+//Must be followed by endTransform
+void BoxShard::beginTransform() {
+    ofPushMatrix();
+    ofTranslate(position.x, position.y, position.z);
+    ofRotateX(currRotation.x);
+    ofRotateY(currRotation.y);
+    ofRotateZ(currRotation.z);
+}
+
+void BoxShard::endTransform() {
+    ofPopMatrix();
+}
+
+//Lighting must already be set up, so that it is only done once for all shards
+void BoxShard::drawSpheres() {
+    beginTransform();
+        for(std::vector<Sphere>::iterator sphere = spheres.begin(); sphere != spheres.end(); ++sphere) {
+            sphere->draw();
+        }
+    endTransform();
+}
+
+//Works out the box in world coordinates, ready for BoxWorld to draw together with the other boxes
+//Writes the box's getNumWireVertices() wireframe vertices to wireVertices
+//Only touches this shard, so it is safe to call for different shards on different threads
+void BoxShard::buildBox(ofVec3f *wireVertices) {
+    fillVertices.clear();
+    fillColors.clear();
+    box.buildGeometry(position, currRotation, wireVertices, fillVertices, fillColors);
+}
+
+vector<ofVec3f> &BoxShard::getFillVertices() {
+    return fillVertices;
+}
+
+vector<GLubyte> &BoxShard::getFillColors() {
+    return fillColors;
+}
+
+//Returns true if the given line, in world coordinates, passes through the sphere around the box
+//Only the part of the line in front of clickStart counts
+bool BoxShard::isHitByRay(ofVec3f clickStart, ofVec3f clickEnd) {
+    ofVec3f clickLineDir = (clickEnd - clickStart).getNormalized();
+    ofVec3f startToCentre = position - clickStart;
+
+    //Distance along the line to the point closest to the centre
+    float closestDist = startToCentre.dot(clickLineDir);
+    if (closestDist < 0) {
+        return startToCentre.length() <= boundingRadius;
+    }
+
+    ofVec3f closestPt = clickStart + clickLineDir * closestDist;
+    return closestPt.distance(position) <= boundingRadius;
+}
+
+//Returns the distance from the start of the given click line, in world coordinates, to the
+//sphere it would push, or a negative distance if it misses every sphere
+float BoxShard::findClick(ofVec3f clickStart, ofVec3f clickEnd) {
+    ofVec3f clickLine[2] = {toLocal(clickStart), toLocal(clickEnd)};
+
+    //Moving and rotating the line doesn't change distances along it
+    float clickDist = -1;
+    findClickedSphere(clickLine, clickDist);
+    return clickDist;
+}
+
+//Pushes the sphere closest to the start of the given click line, which is in world coordinates
+void BoxShard::click(ofVec3f clickStart, ofVec3f clickEnd) {
+    //Undo the shard's position and rotation to get the click line in box coordinates
+    ofVec3f clickLine[2] = {toLocal(clickStart), toLocal(clickEnd)};
+    ofVec3f clickLineDir = clickLine[1] - clickLine[0];
+
+    float closestIntersectionDist = 0;
+    Sphere *closestIntersectionSphere = findClickedSphere(clickLine, closestIntersectionDist);
+
+    //Push the sphere that was closest to the click point
+    if (closestIntersectionSphere != NULL) {
+        wakeSphere(closestIntersectionSphere);
+        closestIntersectionSphere->click(clickLine[0] + (clickLineDir.getNormalized().scale(closestIntersectionDist)), clickLine[0]);
+    }
+}
+
+//Finds the sphere closest to the start of the click line, which is in box coordinates
+//Returns NULL if the line misses every sphere, otherwise sets clickDist to the distance to the sphere
+Sphere *BoxShard::findClickedSphere(ofVec3f clickLine[2], float &clickDist) {
+    //Get direction of clickLine
+    ofVec3f clickLineDir = clickLine[1] - clickLine[0];
+
+    float closestIntersectionDist = 0;
+    Sphere *closestIntersectionSphere = NULL;
+
+    //Check intersection of click ray with each sphere
+    for(std::vector<Sphere>::iterator sphere = spheres.begin(); sphere != spheres.end(); ++sphere) {
+        float clickToSphere = sphere->findRayIntersection(clickLine[0], clickLineDir);
+
+        if (clickToSphere > 0) {
+            //Check if this is the closest sphere to the click point
+            if (closestIntersectionSphere == NULL || clickToSphere < closestIntersectionDist) {
+                closestIntersectionDist = clickToSphere;
+                closestIntersectionSphere = &(*sphere);
+            }
+        }
+    }
+
+    if (closestIntersectionSphere != NULL) {
+        clickDist = closestIntersectionDist;
+    }
+    return closestIntersectionSphere;
+}
+
+//Scripted push: gives every sphere an impulse of the given speed in a random direction
+void BoxShard::kick(float speed) {
+    for(std::vector<Sphere>::iterator sphere = spheres.begin(); sphere != spheres.end(); ++sphere) {
+        ofVec3f impulse(ofRandomf(), ofRandomf(), ofRandomf());
+        wakeSphere(&(*sphere));
+        sphere->applyImpulse(impulse.getNormalized().scale(speed));
+    }
+}
+
+//Puts a sleeping sphere back in the active set. This is the only place spheres should be woken
+//Goes by the active set rather than the sphere's own flag, so a sphere woken some other way still gets stepped
+void BoxShard::wakeSphere(Sphere *sphere) {
+    if (find(activeSpheres.begin(), activeSpheres.end(), sphere) == activeSpheres.end()) {
+        sphere->wake();
+        activeSpheres.push_back(sphere);
+    }
+}
+
+ofVec3f BoxShard::toLocal(ofVec3f worldPt) {
+    ofVec3f localPt = worldPt - position;
+    return localPt.rotate(-currRotation.x, ofVec3f(1,0,0)).rotate(-currRotation.y, ofVec3f(0,1,0)).rotate(-currRotation.z, ofVec3f(0,0,1));
+}
+
+int BoxShard::getNumSpheres() {
+    return spheres.size();
+}
+
+int BoxShard::getNumActive() {
+    return activeSpheres.size();
+}
+
+ofVec3f BoxShard::getPosition() {
+    return position;
+}
+
+ofVec3f BoxShard::getRotation() {
+    return currRotation;
+}
+
+vector<Sphere> &BoxShard::getSpheres() {
+    return spheres;
+}
+
+Box &BoxShard::getBox() {
+    return box;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Box.h"
+#include "Sphere.h"
+
+//One box with its own spheres, rotation and hits, placed at a position in the world
+//A shard shares no mutable state with other shards, so shards can be stepped in parallel
+class BoxShard
+{
+public:
+    BoxShard(ofVec3f position, float boxEdgeLength);
+    void step();
+    void beginTransform();
+    void endTransform();
+    void drawSpheres();
+    void buildBox(ofVec3f *wireVertices);
+    vector<ofVec3f> &getFillVertices();
+    vector<GLubyte> &getFillColors();
+    float findClick(ofVec3f clickStart, ofVec3f clickEnd);
+    void click(ofVec3f clickStart, ofVec3f clickEnd);
+    bool isHitByRay(ofVec3f clickStart, ofVec3f clickEnd);
+    void kick(float speed);
+    int getNumSpheres();
+    int getNumActive();
+    ofVec3f getPosition();
+    ofVec3f getRotation();
+    vector<Sphere> &getSpheres();
+    Box &getBox();
+private:
+    void wakeSphere(Sphere *sphere);
+    Sphere *findClickedSphere(ofVec3f clickLine[2], float &clickDist);
+    ofVec3f toLocal(ofVec3f worldPt);
+
+    ofVec3f position;
+    Box box;
+    vector<Sphere> spheres;
+    vector<Sphere *> activeSpheres;
+    ofVec3f currRotation;
+    float boundingRadius;
+
+    //Coloured squares of the box in world coordinates, from the last buildBox
+    vector<ofVec3f> fillVertices;
+    vector<GLubyte> fillColors;
+};
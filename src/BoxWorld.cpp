@@ -0,0 +1,167 @@
+#include "BoxWorld.h"
+#include <unistd.h>
+
+//Distance between shard centres as a multiple of the box edge, enough for a box's diagonal as it rotates
+#define SHARD_SPACING 1.8
+
+BoxWorld::BoxWorld() {
+    cols = 0;
+    rows = 0;
+    spacing = 0;
+    numWireVerticesPerBox = 0;
+    stepTime = 0;
+}
+
+BoxWorld::~BoxWorld() {
+    workerPool.stop();
+    clear();
+}
+
+//Creates a cols x rows grid of shards centred on the origin in the z = 0 plane
+//numThreads of 0 or less uses one thread per core
+void BoxWorld::setup(int cols, int rows, float boxEdgeLength, int numThreads) {
+    clear();
+
+    this->cols = max(cols, 1);
+    this->rows = max(rows, 1);
+    spacing = boxEdgeLength * SHARD_SPACING;
+
+    for (int row = 0; row < this->rows; row++) {
+        for (int col = 0; col < this->cols; col++) {
+            ofVec3f position(
+                (col - (this->cols - 1) / 2.0) * spacing,
+                ((this->rows - 1) / 2.0 - row) * spacing,
+                0
+            );
+            shards.push_back(new BoxShard(position, boxEdgeLength));
+        }
+    }
+
+    numWireVerticesPerBox = shards[0]->getBox().getNumWireVertices();
+    wireVertices.resize(shards.size() * numWireVerticesPerBox);
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        shards[i]->buildBox(&wireVertices[i * numWireVerticesPerBox]);
+    }
+
+    if (numThreads <= 0) {
+        numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    workerPool.start(min(max(numThreads, 1), (int)shards.size()));
+
+    printf("Box world: %dx%d shards on %d threads\n", this->cols, this->rows, workerPool.getNumThreads());
+}
+
+void BoxWorld::clear() {
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        delete shards[i];
+    }
+    shards.clear();
+    wireVertices.clear();
+}
+
+//Steps and builds the boxes of every shard, in parallel, and returns once they are all done
+void BoxWorld::step() {
+    float startTime = ofGetElapsedTimef();
+    workerPool.run(this, shards.size());
+    stepTime = ofGetElapsedTimef() - startTime;
+}
+
+void BoxWorld::runJob(int shard) {
+    shards[shard]->step();
+    shards[shard]->buildBox(&wireVertices[shard * numWireVerticesPerBox]);
+}
+
+//Draws all shards: lighting is set up once for all the spheres, then all the boxes built by step are drawn at once
+void BoxWorld::draw(const GLfloat *lightPosition) {
+    glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
+
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+        for (unsigned int i = 0; i < shards.size(); i++) {
+            shards[i]->drawSpheres();
+        }
+    glDisable(GL_LIGHTING);
+    glDisable(GL_LIGHT0);
+
+    fillVertices.clear();
+    fillColors.clear();
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        fillVertices.insert(fillVertices.end(), shards[i]->getFillVertices().begin(), shards[i]->getFillVertices().end());
+        fillColors.insert(fillColors.end(), shards[i]->getFillColors().begin(), shards[i]->getFillColors().end());
+    }
+
+    Box::drawGeometry(wireVertices, fillVertices, fillColors);
+}
+
+//Routes a click line in world coordinates to the shard with the sphere it would push
+void BoxWorld::click(ofVec3f clickStart, ofVec3f clickEnd) {
+    BoxShard *shard = findClickedShard(clickStart, clickEnd);
+    if (shard != NULL) {
+        shard->click(clickStart, clickEnd);
+    }
+}
+
+//Of the shards whose bounding sphere the click line passes through, finds the one with the sphere
+//closest to the start of the line. Works whatever the camera angle. Returns NULL if no sphere is hit
+BoxShard *BoxWorld::findClickedShard(ofVec3f clickStart, ofVec3f clickEnd) {
+    BoxShard *closestShard = NULL;
+    float closestDist = 0;
+
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        if (!shards[i]->isHitByRay(clickStart, clickEnd)) {
+            continue;
+        }
+
+        float clickDist = shards[i]->findClick(clickStart, clickEnd);
+        if (clickDist > 0 && (closestShard == NULL || clickDist < closestDist)) {
+            closestDist = clickDist;
+            closestShard = shards[i];
+        }
+    }
+
+    return closestShard;
+}
+
+void BoxWorld::kick(float speed) {
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        shards[i]->kick(speed);
+    }
+}
+
+int BoxWorld::getNumShards() {
+    return shards.size();
+}
+
+BoxShard &BoxWorld::getShard(int index) {
+    return *shards[index];
+}
+
+int BoxWorld::getNumSpheres() {
+    int numSpheres = 0;
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        numSpheres += shards[i]->getNumSpheres();
+    }
+    return numSpheres;
+}
+
+int BoxWorld::getNumActive() {
+    int numActive = 0;
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        numActive += shards[i]->getNumActive();
+    }
+    return numActive;
+}
+
+//Number of shards along the longest side of the grid
+float BoxWorld::getSize() {
+    return max(cols, rows);
+}
+
+int BoxWorld::getNumThreads() {
+    return workerPool.getNumThreads();
+}
+
+//Time taken by the last call to step (s)
+float BoxWorld::getStepTime() {
+    return stepTime;
+}
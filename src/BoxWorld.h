@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+#include "BoxShard.h"
+#include "WorkerPool.h"
+
+//A grid of independent box shards, stepped in parallel with one shard per job
+class BoxWorld : public WorkerJob
+{
+public:
+    BoxWorld();
+    ~BoxWorld();
+    void setup(int cols, int rows, float boxEdgeLength, int numThreads);
+    void step();
+    void draw(const GLfloat *lightPosition);
+    void click(ofVec3f clickStart, ofVec3f clickEnd);
+    void kick(float speed);
+    int getNumShards();
+    BoxShard &getShard(int index);
+    int getNumSpheres();
+    int getNumActive();
+    float getSize();
+    int getNumThreads();
+    float getStepTime();
+    void runJob(int shard);
+private:
+    BoxShard *findClickedShard(ofVec3f clickStart, ofVec3f clickEnd);
+    void clear();
+
+    //Shards are held by pointer as their spheres point at their box
+    vector<BoxShard *> shards;
+    int cols;
+    int rows;
+    float spacing;
+
+    //All boxes in world coordinates, so that they are drawn with one draw call for the coloured
+    //squares and one for the wireframes. Each shard writes its own part of wireVertices
+    vector<ofVec3f> wireVertices;
+    vector<ofVec3f> fillVertices;
+    vector<GLubyte> fillColors;
+    int numWireVerticesPerBox;
+
+    WorkerPool workerPool;
+    float stepTime;
+};
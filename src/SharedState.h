@@ -0,0 +1,83 @@
+#pragma once
+
+//Layout of the shared memory that BounceBox publishes its state into each frame
+//This header is shared with external readers, so it must not depend on openFrameworks
+
+#include <stdint.h>
+
+#define SHARED_STATE_NAME "/bouncebox_state"
+#define SHARED_STATE_MAGIC 0x424f5843
+#define SHARED_STATE_VERSION 3
+
+//Number of frames kept in the ring, readers that fall further behind than this miss frames
+#define SHARED_STATE_NUM_SLOTS 16
+//BounceBox refuses to run with more boxes than fit, and each box has 3 spheres which bounce at most once a frame,
+//so the sphere and bounce limits are never reached either
+#define SHARED_STATE_MAX_SHARDS 64
+#define SHARED_STATE_MAX_SPHERES 256
+#define SHARED_STATE_MAX_BOUNCES 256
+
+typedef struct sharedVec3 {
+    float x, y, z;
+} sharedVec3;
+
+//One box of the grid, positioned in world coordinates and rotated by rotation (degrees about x, then y, then z)
+typedef struct sharedShard {
+    sharedVec3 pos;
+    sharedVec3 rotation;
+} sharedShard;
+
+//Positions are in the coordinates of the sphere's box
+typedef struct sharedSphere {
+    sharedVec3 pos;
+    sharedVec3 vel;
+    uint8_t color[4];
+    uint8_t awake;
+    uint8_t padding;
+    uint16_t shard;
+} sharedSphere;
+
+//A sphere hitting a face of its box. Positions are in box coordinates
+//Faces are numbered front, back, left, right, top, bottom
+typedef struct sharedBounce {
+    int32_t faceIndex;
+    int32_t shard;
+    sharedVec3 hitPt;
+    uint8_t color[4];
+} sharedBounce;
+
+typedef struct sharedFrame {
+    uint64_t tick;
+    double time;
+    uint8_t tokenFound;
+    uint8_t padding[7];
+    sharedVec3 tokenPos;
+    sharedVec3 displayTokenPos;
+    uint32_t numShards;
+    uint32_t numSpheres;
+    uint32_t numBounces;
+    sharedShard shards[SHARED_STATE_MAX_SHARDS];
+    sharedSphere spheres[SHARED_STATE_MAX_SPHERES];
+    sharedBounce bounces[SHARED_STATE_MAX_BOUNCES];
+} sharedFrame;
+
+//Each slot is guarded by a sequence number which is odd while the slot is being written
+//Readers copy a slot and retry or give up if the sequence number was odd or changed, so the writer never waits
+typedef struct sharedSlot {
+    volatile uint32_t seq;
+    uint32_t padding;
+    sharedFrame frame;
+} sharedSlot;
+
+typedef struct sharedState {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numSlots;
+    uint32_t slotSize;
+    //Changed each time the app starts publishing, when ticks start again from 0
+    volatile uint32_t epoch;
+    uint32_t padding;
+    //Tick of the most recently completed frame, 0 until the first frame is published
+    volatile uint64_t latestTick;
+    sharedSlot slots[SHARED_STATE_NUM_SLOTS];
+} sharedState;
@@ -3,6 +3,10 @@
 #define DECEL_RATE 0.99
 #define VEL_SCALE 5
 
+//A sphere slower than this (in units per frame) for SLEEP_FRAMES consecutive frames is put to sleep
+#define SLEEP_VEL_THRESHOLD 0.01
+#define SLEEP_FRAMES 30
+
 const GLfloat specular[] = {255.0, 255.0, 255.0, 0.5};
 const GLfloat shininess[] = {128.0};
 
@@ -13,6 +17,8 @@ Sphere::Sphere (Box *bounceBox, ofVec3f centre, int radius, ofColor color) {
     this->clickPt = NULL;
     this->currVel = ofVec3f(0.0,0.0,0.0);
     this->color = color; 
+    this->awake = false;
+    this->restingFrames = 0;
 }
 
 //Finds the intersection between the given ray and this sphere
@@ -62,9 +68,49 @@ void Sphere::click(ofVec3f clickIntersection, ofVec3f clickOrigin) {
     currVel += clickIntersectionToCentre.getScaled(VEL_SCALE * cos(angle));
 }
 
+//Adds the given velocity to the sphere, e.g. for pushes that don't come from a click
+void Sphere::applyImpulse(ofVec3f impulse) {
+    currVel += impulse;
+}
+
+ofVec3f Sphere::getCentre() {
+    return centre;
+}
+
+ofVec3f Sphere::getVelocity() {
+    return currVel;
+}
+
+ofColor Sphere::getColor() {
+    return color;
+}
+
+bool Sphere::isAwake() {
+    return awake;
+}
+
+//Only the owner of the sphere should wake it, as it also has to put the sphere back in its active set
+//Pushes don't wake the sphere themselves, so the owner can never miss one
+void Sphere::wake() {
+    awake = true;
+    restingFrames = 0;
+}
+
+//Stops the sphere dead so that it costs nothing until it is woken again
+void Sphere::sleep() {
+    awake = false;
+    restingFrames = 0;
+    currVel = ofVec3f(0.0, 0.0, 0.0);
+}
+
 //Updates the position of the sphere each frame
-void Sphere::updatePos()
+//Returns false if the sphere has come to rest and gone to sleep
+bool Sphere::updatePos()
 {
+    if (!awake) {
+        return false;
+    }
+
     centre += currVel;
 
     //Detect if the sphere has hit the side of the box and reverse the appropriate component of the velocity
@@ -84,12 +130,23 @@ void Sphere::updatePos()
     }
 
     currVel = currVel * DECEL_RATE;
+
+    //Go to sleep once the sphere has visibly stopped for a while
+    if (currVel.lengthSquared() < SLEEP_VEL_THRESHOLD * SLEEP_VEL_THRESHOLD) {
+        restingFrames++;
+        if (restingFrames >= SLEEP_FRAMES) {
+            sleep();
+        }
+    } else {
+        restingFrames = 0;
+    }
+
+    return awake;
 }
    
+//Only draws the sphere, the position is stepped separately by updatePos
 void Sphere::customDraw()
 {
-    updatePos();
-
     GLfloat ambient[] = {color.r / 255.0, color.g / 255.0, color.b / 255.0, 1.0};
 
     //Enable lighting to create shiny sphere
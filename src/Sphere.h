@@ -10,10 +10,17 @@ public:
     Sphere(Box *bounceBox, ofVec3f centre, int radius, ofColor color);
 	void	customDraw();
     void    click(ofVec3f clickIntersection, ofVec3f clickOrigin);
+    void    applyImpulse(ofVec3f impulse);
     float   findRayIntersection(ofVec3f origin, ofVec3f direction);
+    bool    updatePos();
+    ofVec3f getCentre();
+    ofVec3f getVelocity();
+    ofColor getColor();
+    bool    isAwake();
+    void    wake();
 
 private:
-    void updatePos();
+    void sleep();
 
     Box *bounceBox;
     ofVec3f centre;
@@ -21,4 +28,6 @@ private:
     ofVec3f clickPt;
     ofVec3f currVel;
     ofColor color;
+    bool awake;
+    int restingFrames;
 };
@@ -0,0 +1,118 @@
+#include "StatePublisher.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+StatePublisher::StatePublisher() {
+    state = NULL;
+    currSlot = NULL;
+    tick = 0;
+}
+
+StatePublisher::~StatePublisher() {
+    close();
+}
+
+//Creates and maps the shared memory. Returns false if it could not be, in which case nothing is published
+bool StatePublisher::open() {
+    int fd = shm_open(SHARED_STATE_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("StatePublisher: shm_open");
+        return false;
+    }
+
+    if (ftruncate(fd, sizeof(sharedState)) < 0) {
+        perror("StatePublisher: ftruncate");
+        ::close(fd);
+        return false;
+    }
+
+    void *mem = mmap(NULL, sizeof(sharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        perror("StatePublisher: mmap");
+        return false;
+    }
+
+    //Readers only trust the rest of the header once they have seen the magic, so clear it
+    //while the header is rewritten and set it last
+    state = (sharedState *)mem;
+    uint32_t prevEpoch = state->epoch;
+    state->magic = 0;
+    __sync_synchronize();
+    state->version = SHARED_STATE_VERSION;
+    state->numSlots = SHARED_STATE_NUM_SLOTS;
+    state->slotSize = sizeof(sharedSlot);
+    state->padding = 0;
+    state->latestTick = 0;
+
+    //Clear the frames but carry on from the last run's sequence numbers rather than resetting them,
+    //so that a reader still copying a slot always sees its sequence number change
+    for (int i = 0; i < SHARED_STATE_NUM_SLOTS; i++) {
+        sharedSlot *slot = &state->slots[i];
+
+        //A run that died mid-write leaves the sequence number odd already
+        if ((slot->seq & 1) == 0) {
+            slot->seq++;
+        }
+        __sync_synchronize();
+        memset(&slot->frame, 0, sizeof(sharedFrame));
+        __sync_synchronize();
+        slot->seq++;
+    }
+
+    //A new epoch tells readers left from the last run that ticks have started again
+    state->epoch = prevEpoch + 1;
+    __sync_synchronize();
+    state->magic = SHARED_STATE_MAGIC;
+
+    tick = 0;
+    printf("Publishing state to shared memory %s\n", SHARED_STATE_NAME);
+    return true;
+}
+
+//Unmaps the shared memory. It is left in place so that readers can keep reading the last frames
+void StatePublisher::close() {
+    if (state != NULL) {
+        munmap(state, sizeof(sharedState));
+        state = NULL;
+        currSlot = NULL;
+    }
+}
+
+bool StatePublisher::isOpen() {
+    return state != NULL;
+}
+
+//Returns the frame to fill in for this tick, or NULL if the shared memory isn't open
+//Must be followed by endFrame
+sharedFrame *StatePublisher::beginFrame() {
+    if (state == NULL) {
+        return NULL;
+    }
+
+    tick++;
+    currSlot = &state->slots[tick % SHARED_STATE_NUM_SLOTS];
+
+    //Odd sequence number marks the slot as being written
+    currSlot->seq++;
+    __sync_synchronize();
+
+    currSlot->frame.tick = tick;
+    return &currSlot->frame;
+}
+
+//Marks the frame from beginFrame as complete and makes it the latest
+void StatePublisher::endFrame() {
+    if (currSlot == NULL) {
+        return;
+    }
+
+    __sync_synchronize();
+    currSlot->seq++;
+    __sync_synchronize();
+    state->latestTick = tick;
+    currSlot = NULL;
+}
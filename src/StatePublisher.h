@@ -0,0 +1,21 @@
+#pragma once
+
+#include "SharedState.h"
+
+//Publishes frames into a POSIX shared memory ring for external processes to read
+//Frames are written in place, and publishing never waits for readers
+class StatePublisher
+{
+public:
+    StatePublisher();
+    ~StatePublisher();
+    bool open();
+    void close();
+    bool isOpen();
+    sharedFrame *beginFrame();
+    void endFrame();
+private:
+    sharedState *state;
+    sharedSlot *currSlot;
+    uint64_t tick;
+};
@@ -0,0 +1,111 @@
+#include "TokenPredictor.h"
+
+//One Euro filter parameters: cutoff at rest (Hz), how fast the cutoff rises with speed, and the cutoff for the velocity
+#define MIN_CUTOFF 1.0
+#define CUTOFF_SLOPE 0.007
+#define VEL_CUTOFF 1.0
+
+//Never extrapolate further than this (s), however long the latency
+#define MAX_PREDICTION_TIME 0.15
+
+//Weight of each new measurement in the smoothed latency and time between samples
+#define LATENCY_SMOOTHING 0.1
+#define SAMPLE_INTERVAL_SMOOTHING 0.1
+
+TokenPredictor::TokenPredictor() {
+    reset();
+}
+
+void TokenPredictor::reset() {
+    initialised = false;
+    newSample = false;
+    lastSampleTime = 0;
+    sampleInterval = 0;
+    filteredPos = ofVec2f(0, 0);
+    filteredVel = ofVec2f(0, 0);
+    rawPos = ofVec2f(0, 0);
+    latency = 0;
+    lead = 0;
+}
+
+bool TokenPredictor::hasSamples() {
+    return initialised;
+}
+
+//Adds a detected token position, timestamped with when the frame was captured
+void TokenPredictor::addSample(ofVec2f pos, float sampleTime) {
+    rawPos = pos;
+    newSample = true;
+
+    if (!initialised) {
+        filteredPos = pos;
+        filteredVel = ofVec2f(0, 0);
+        lastSampleTime = sampleTime;
+        initialised = true;
+        return;
+    }
+
+    float dt = sampleTime - lastSampleTime;
+    if (dt <= 0) {
+        return;
+    }
+    lastSampleTime = sampleTime;
+
+    if (sampleInterval == 0) {
+        sampleInterval = dt;
+    } else {
+        sampleInterval += (dt - sampleInterval) * SAMPLE_INTERVAL_SMOOTHING;
+    }
+
+    //Filter the velocity, then use its speed to open up the position cutoff:
+    //slow movements are smoothed heavily to remove jitter, fast ones are followed closely to cut lag
+    ofVec2f vel = (pos - filteredPos) * (1.0 / dt);
+    float velAlpha = smoothingFactor(VEL_CUTOFF, dt);
+    filteredVel = filteredVel * (1 - velAlpha) + vel * velAlpha;
+
+    float cutoff = MIN_CUTOFF + CUTOFF_SLOPE * filteredVel.length();
+    float posAlpha = smoothingFactor(cutoff, dt);
+    filteredPos = filteredPos * (1 - posAlpha) + pos * posAlpha;
+}
+
+//Returns the estimated token position at the given display time
+//Once a sample is more than a frame interval overdue the token is taken to be lost, and the
+//last filtered position is returned rather than extrapolating past it
+ofVec2f TokenPredictor::predict(float displayTime) {
+    float predictionTime = displayTime - lastSampleTime;
+
+    //Only a frame with a new sample measures the pipeline, otherwise this is time since the token was last seen
+    if (newSample) {
+        if (latency == 0) {
+            latency = predictionTime;
+        } else {
+            latency += (predictionTime - latency) * LATENCY_SMOOTHING;
+        }
+        newSample = false;
+    }
+
+    ofVec2f predicted = filteredPos;
+    if (predictionTime <= latency + sampleInterval) {
+        predictionTime = ofClamp(predictionTime, 0, MAX_PREDICTION_TIME);
+        predicted += filteredVel * predictionTime;
+    }
+
+    lead = (predicted - rawPos).length();
+    return predicted;
+}
+
+//Time from capture to display (s), smoothed over the frames that had a new sample
+float TokenPredictor::getLatency() {
+    return latency;
+}
+
+//Distance between the last prediction and the last raw sample (px)
+float TokenPredictor::getLead() {
+    return lead;
+}
+
+//Exponential smoothing factor for a low-pass filter with the given cutoff (Hz)
+float TokenPredictor::smoothingFactor(float cutoff, float dt) {
+    float tau = 1.0 / (2 * PI * cutoff);
+    return 1.0 / (1.0 + tau / dt);
+}
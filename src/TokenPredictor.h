@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ofMain.h"
+
+//Smooths token positions with a One Euro filter and extrapolates them
+//with the filtered velocity to where the token will be at display time
+class TokenPredictor
+{
+public:
+    TokenPredictor();
+    void addSample(ofVec2f pos, float sampleTime);
+    ofVec2f predict(float displayTime);
+    void reset();
+    bool hasSamples();
+    float getLatency();
+    float getLead();
+private:
+    float smoothingFactor(float cutoff, float dt);
+
+    bool initialised;
+    bool newSample;
+    float lastSampleTime;
+    float sampleInterval;
+    ofVec2f filteredPos;
+    ofVec2f filteredVel;
+    ofVec2f rawPos;
+    float latency;
+    float lead;
+};
@@ -0,0 +1,140 @@
+#include "VideoOverlay.h"
+
+//One buffer and texture being drawn, one being uploaded and one being written, so none of them waits on another
+#define NUM_PIXEL_BUFFERS 3
+#define BYTES_PER_PIXEL 4
+
+//Blends the mask (alpha) over the webcam image (rgb) as a grey overlay
+static const string vertexShaderSource =
+    "void main() {\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const string fragmentShaderSource =
+    "uniform sampler2D tex;\n"
+    "uniform float maskOpacity;\n"
+    "void main() {\n"
+    "    vec4 texel = texture2D(tex, gl_TexCoord[0].st);\n"
+    "    gl_FragColor = vec4(mix(texel.rgb, vec3(texel.a), maskOpacity), 1.0);\n"
+    "}\n";
+
+VideoOverlay::VideoOverlay() {
+    width = 0;
+    height = 0;
+    currBuffer = 0;
+    mapped = false;
+    uploadingBuffer = -1;
+    drawBuffer = -1;
+}
+
+VideoOverlay::~VideoOverlay() {
+    if (!pixelBuffers.empty()) {
+        glDeleteBuffers(pixelBuffers.size(), &pixelBuffers[0]);
+    }
+    if (!textures.empty()) {
+        glDeleteTextures(textures.size(), &textures[0]);
+    }
+}
+
+//Creates the textures, the pixel buffers and the shader. Needs a GL context
+void VideoOverlay::allocate(int width, int height) {
+    this->width = width;
+    this->height = height;
+
+    textures.resize(NUM_PIXEL_BUFFERS);
+    glGenTextures(NUM_PIXEL_BUFFERS, &textures[0]);
+    for (int i = 0; i < NUM_PIXEL_BUFFERS; i++) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    pixelBuffers.resize(NUM_PIXEL_BUFFERS);
+    glGenBuffers(NUM_PIXEL_BUFFERS, &pixelBuffers[0]);
+    for (int i = 0; i < NUM_PIXEL_BUFFERS; i++) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * BYTES_PER_PIXEL, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    shader.setupShaderFromSource(GL_VERTEX_SHADER, vertexShaderSource);
+    shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    shader.linkProgram();
+}
+
+//Maps the next pixel buffer and returns it for the caller to fill with width * height RGBA pixels
+//Only needs calling for new frames. Returns NULL if it couldn't be mapped, in which case the last frame stays on screen
+unsigned char *VideoOverlay::beginFrame() {
+    //Skip the buffers still being drawn from or uploaded, so mapping this one never waits on either
+    do {
+        currBuffer = (currBuffer + 1) % NUM_PIXEL_BUFFERS;
+    } while (currBuffer == drawBuffer || currBuffer == uploadingBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[currBuffer]);
+
+    unsigned char *pixels = (unsigned char *)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+
+    mapped = (pixels != NULL);
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    return pixels;
+}
+
+//Unmaps the buffer filled since beginFrame and starts copying it into its own texture
+//The copy is done by the driver from the buffer while draw keeps using the previous texture,
+//so neither this thread nor drawing waits for it. The new texture is drawn from the next frame on
+void VideoOverlay::endFrame() {
+    if (!mapped) {
+        return;
+    }
+
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glBindTexture(GL_TEXTURE_2D, textures[currBuffer]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    mapped = false;
+    uploadingBuffer = currBuffer;
+}
+
+//Draws the image mirrored left to right, which is done by the texture coordinates rather than moving pixels
+//maskOpacity of 0 shows only the webcam image
+//Draws the texture uploaded before this frame, then switches to any uploaded this frame for the next one
+void VideoOverlay::draw(float x, float y, float w, float h, float maskOpacity) {
+    if (drawBuffer >= 0) {
+        drawTexture(x, y, w, h, maskOpacity);
+    }
+
+    if (uploadingBuffer >= 0) {
+        drawBuffer = uploadingBuffer;
+        uploadingBuffer = -1;
+    }
+}
+
+void VideoOverlay::drawTexture(float x, float y, float w, float h, float maskOpacity) {
+    shader.begin();
+        shader.setUniform1i("tex", 0);
+        shader.setUniform1f("maskOpacity", maskOpacity);
+
+        glActiveTexture(GL_TEXTURE0);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, textures[drawBuffer]);
+
+        glBegin(GL_QUADS);
+            glTexCoord2f(1, 0); glVertex2f(x, y);
+            glTexCoord2f(0, 0); glVertex2f(x + w, y);
+            glTexCoord2f(0, 1); glVertex2f(x + w, y + h);
+            glTexCoord2f(1, 1); glVertex2f(x, y + h);
+        glEnd();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+    shader.end();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ofMain.h"
+
+//Streams the webcam image and the token mask to the GPU and draws them mirrored
+//Both are packed into one RGBA texture, with the mask in the alpha channel, which is
+//uploaded asynchronously from a ring of pixel buffer objects, each with its own texture
+class VideoOverlay
+{
+public:
+    VideoOverlay();
+    ~VideoOverlay();
+    void allocate(int width, int height);
+    unsigned char *beginFrame();
+    void endFrame();
+    void draw(float x, float y, float w, float h, float maskOpacity);
+private:
+    void drawTexture(float x, float y, float w, float h, float maskOpacity);
+
+    int width;
+    int height;
+    vector<GLuint> textures;
+    vector<GLuint> pixelBuffers;
+    int currBuffer;
+    bool mapped;
+
+    //Texture uploaded this frame, drawn from the next frame on, and the texture being drawn, -1 if none
+    int uploadingBuffer;
+    int drawBuffer;
+    ofShader shader;
+};
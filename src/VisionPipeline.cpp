@@ -0,0 +1,166 @@
+#include "VisionPipeline.h"
+#include <string.h>
+#include <unistd.h>
+
+//Rows above and below each band that are also thresholded, so that erosion at the seams sees its real neighbours
+#define HALO_ROWS 1
+
+VisionPipeline::VisionPipeline() {
+    width = 0;
+    height = 0;
+    numBands = 0;
+    nBlobs = 0;
+    currRgb = NULL;
+    currPacked = NULL;
+    currDetecting = false;
+    processTime = 0;
+}
+
+VisionPipeline::~VisionPipeline() {
+    workerPool.stop();
+    releaseBands();
+}
+
+//Allocates the bands for width x height frames. numThreads of 0 or less uses one thread per core
+void VisionPipeline::setup(int width, int height, int numThreads) {
+    this->width = width;
+    this->height = height;
+
+    if (numThreads <= 0) {
+        numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    if (numThreads > height) {
+        numThreads = height;
+    }
+
+    workerPool.start(numThreads);
+    numBands = workerPool.getNumThreads();
+
+    releaseBands();
+    int maxBandRows = (height + numBands - 1) / numBands + 2 * HALO_ROWS;
+    for (int i = 0; i < numBands; i++) {
+        hsvBands.push_back(cvCreateMat(maxBandRows, width, CV_8UC3));
+        threshedBands.push_back(cvCreateMat(maxBandRows, width, CV_8UC1));
+        erodedBands.push_back(cvCreateMat(maxBandRows, width, CV_8UC1));
+    }
+    bandLabellers.resize(numBands);
+    mask.assign(width * height, 0);
+
+    printf("Vision pipeline: %dx%d in %d bands\n", width, height, numBands);
+}
+
+void VisionPipeline::releaseBands() {
+    for (unsigned int i = 0; i < hsvBands.size(); i++) {
+        cvReleaseMat(&hsvBands[i]);
+        cvReleaseMat(&threshedBands[i]);
+        cvReleaseMat(&erodedBands[i]);
+    }
+    hsvBands.clear();
+    threshedBands.clear();
+    erodedBands.clear();
+}
+
+//Finds up to maxBlobs blobs with an area in [minArea, maxArea] whose HSV colour is within [lower, upper]
+//rgb must be a tightly packed width x height frame. Unless packed is NULL, the frame is also written to it
+//as RGBA with the mask in alpha. Returns the number of blobs found
+int VisionPipeline::process(unsigned char *rgb, unsigned char *packed, CvScalar lower, CvScalar upper, int minArea, int maxArea, int maxBlobs) {
+    float startTime = ofGetElapsedTimef();
+
+    currRgb = rgb;
+    currPacked = packed;
+    currDetecting = true;
+    currLower = lower;
+    currUpper = upper;
+    workerPool.run(this, numBands);
+
+    nBlobs = labeller.mergeBands(bandLabellers, minArea, maxArea, maxBlobs);
+    blobs = labeller.blobs;
+
+    processTime = ofGetElapsedTimef() - startTime;
+    return nBlobs;
+}
+
+//Writes the frame to packed as RGBA with an empty alpha channel, spread across the threads
+void VisionPipeline::pack(unsigned char *rgb, unsigned char *packed) {
+    if (packed == NULL) {
+        return;
+    }
+
+    currRgb = rgb;
+    currPacked = packed;
+    currDetecting = false;
+    workerPool.run(this, numBands);
+}
+
+//Converts, thresholds, erodes, labels and packs one band of the current frame
+//Bands only write to their own scratch images, labeller and rows of the mask and packed frame
+void VisionPipeline::runJob(int band) {
+    int firstRow = height * band / numBands;
+    int endRow = height * (band + 1) / numBands;
+
+    if (!currDetecting) {
+        packRows(firstRow, endRow, false);
+        return;
+    }
+
+    //Include the halo rows, except past the edges of the frame
+    int haloFirstRow = max(firstRow - HALO_ROWS, 0);
+    int haloEndRow = min(endRow + HALO_ROWS, height);
+    int haloRows = haloEndRow - haloFirstRow;
+
+    CvMat rgbRows = cvMat(haloRows, width, CV_8UC3, currRgb + haloFirstRow * width * 3);
+    CvMat hsvRows, threshedRows, erodedRows;
+    cvGetRows(hsvBands[band], &hsvRows, 0, haloRows);
+    cvGetRows(threshedBands[band], &threshedRows, 0, haloRows);
+    cvGetRows(erodedBands[band], &erodedRows, 0, haloRows);
+
+    cvCvtColor(&rgbRows, &hsvRows, CV_RGB2HSV);
+    cvInRangeS(&hsvRows, currLower, currUpper, &threshedRows);
+    cvErode(&threshedRows, &erodedRows);
+
+    //Copy out the band's own rows, the halo rows belong to the neighbouring bands
+    for (int y = firstRow; y < endRow; y++) {
+        memcpy(&mask[y * width], erodedRows.data.ptr + (y - haloFirstRow) * erodedRows.step, width);
+    }
+
+    bandLabellers[band].labelBand(&mask[firstRow * width], width, firstRow, endRow - firstRow);
+
+    //Pack while the band's rows are still in cache
+    packRows(firstRow, endRow, true);
+}
+
+//Interleaves rows of the current frame and, if withMask, the mask into the packed frame
+void VisionPipeline::packRows(int firstRow, int endRow, bool withMask) {
+    if (currPacked == NULL) {
+        return;
+    }
+
+    for (int i = firstRow * width; i < endRow * width; i++) {
+        currPacked[4 * i] = currRgb[3 * i];
+        currPacked[4 * i + 1] = currRgb[3 * i + 1];
+        currPacked[4 * i + 2] = currRgb[3 * i + 2];
+        currPacked[4 * i + 3] = withMask ? mask[i] : 0;
+    }
+}
+
+//Returns the HSV colour of one pixel of an RGB frame
+CvScalar VisionPipeline::getHsv(unsigned char *rgb, int x, int y) {
+    unsigned char hsv[3];
+    CvMat rgbPixel = cvMat(1, 1, CV_8UC3, rgb + (y * width + x) * 3);
+    CvMat hsvPixel = cvMat(1, 1, CV_8UC3, hsv);
+    cvCvtColor(&rgbPixel, &hsvPixel, CV_RGB2HSV);
+
+    return cvScalar(hsv[0], hsv[1], hsv[2]);
+}
+
+int VisionPipeline::getNumThreads() {
+    return numBands;
+}
+
+//Time taken by the last call to process (s)
+float VisionPipeline::getProcessTime() {
+    return processTime;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOpenCv.h"
+#include "BlobLabeller.h"
+#include "WorkerPool.h"
+
+//Finds the token blobs in RGB webcam frames
+//Each frame is split into horizontal bands which are converted to HSV, thresholded, eroded and labelled
+//in parallel, one band per thread, then the blobs of the bands are merged
+class VisionPipeline : public WorkerJob
+{
+public:
+    VisionPipeline();
+    ~VisionPipeline();
+    void setup(int width, int height, int numThreads);
+    int process(unsigned char *rgb, unsigned char *packed, CvScalar lower, CvScalar upper, int minArea, int maxArea, int maxBlobs);
+    void pack(unsigned char *rgb, unsigned char *packed);
+    CvScalar getHsv(unsigned char *rgb, int x, int y);
+    int getNumThreads();
+    float getProcessTime();
+    void runJob(int band);
+
+    vector<labelledBlob> blobs;
+    int nBlobs;
+private:
+    void releaseBands();
+    void packRows(int firstRow, int endRow, bool withMask);
+
+    int width;
+    int height;
+    int numBands;
+
+    //Per-band scratch images, which have room for a row of halo above and below the band
+    vector<CvMat *> hsvBands;
+    vector<CvMat *> threshedBands;
+    vector<CvMat *> erodedBands;
+    vector<BlobLabeller> bandLabellers;
+    BlobLabeller labeller;
+    vector<unsigned char> mask;
+
+    //Inputs for the bands of the current frame
+    unsigned char *currRgb;
+    unsigned char *currPacked;
+    bool currDetecting;
+    CvScalar currLower;
+    CvScalar currUpper;
+
+    WorkerPool workerPool;
+    float processTime;
+};
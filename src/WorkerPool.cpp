@@ -0,0 +1,122 @@
+#include "WorkerPool.h"
+#include <stdio.h>
+
+WorkerPool::WorkerPool() {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&workReady, NULL);
+    pthread_cond_init(&workDone, NULL);
+
+    currJob = NULL;
+    numJobs = 0;
+    nextJob = 0;
+    jobsDone = 0;
+    generation = 0;
+    stopping = false;
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+
+    pthread_cond_destroy(&workDone);
+    pthread_cond_destroy(&workReady);
+    pthread_mutex_destroy(&mutex);
+}
+
+//Starts numThreads - 1 threads. If any can't be started, the pool carries on with those that were
+void WorkerPool::start(int numThreads) {
+    stop();
+    stopping = false;
+
+    for (int i = 1; i < numThreads; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, threadMain, this) != 0) {
+            printf("WorkerPool: could only start %d of %d threads\n", i, numThreads);
+            break;
+        }
+        threads.push_back(thread);
+    }
+}
+
+void WorkerPool::stop() {
+    pthread_mutex_lock(&mutex);
+        stopping = true;
+        pthread_cond_broadcast(&workReady);
+    pthread_mutex_unlock(&mutex);
+
+    for (unsigned int i = 0; i < threads.size(); i++) {
+        pthread_join(threads[i], NULL);
+    }
+    threads.clear();
+}
+
+//Includes the calling thread
+int WorkerPool::getNumThreads() {
+    return threads.size() + 1;
+}
+
+//Runs job->runJob(i) for every i in [0, numJobs) across the pool and returns once they have all finished
+void WorkerPool::run(WorkerJob *job, int numJobs) {
+    pthread_mutex_lock(&mutex);
+        currJob = job;
+        this->numJobs = numJobs;
+        nextJob = 0;
+        jobsDone = 0;
+        generation++;
+        pthread_cond_broadcast(&workReady);
+    pthread_mutex_unlock(&mutex);
+
+    runJobs();
+
+    pthread_mutex_lock(&mutex);
+        while (jobsDone < numJobs) {
+            pthread_cond_wait(&workDone, &mutex);
+        }
+        currJob = NULL;
+    pthread_mutex_unlock(&mutex);
+}
+
+void *WorkerPool::threadMain(void *pool) {
+    ((WorkerPool *)pool)->workLoop();
+    return NULL;
+}
+
+//Waits for each new batch of jobs and helps run it
+void WorkerPool::workLoop() {
+    unsigned int seenGeneration = 0;
+
+    pthread_mutex_lock(&mutex);
+    seenGeneration = generation;
+    while (true) {
+        while (!stopping && generation == seenGeneration) {
+            pthread_cond_wait(&workReady, &mutex);
+        }
+        if (stopping) {
+            break;
+        }
+        seenGeneration = generation;
+
+        pthread_mutex_unlock(&mutex);
+            runJobs();
+        pthread_mutex_lock(&mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+//Takes jobs from the current batch until there are none left
+void WorkerPool::runJobs() {
+    pthread_mutex_lock(&mutex);
+    while (nextJob < numJobs) {
+        int jobIndex = nextJob++;
+        WorkerJob *job = currJob;
+
+        pthread_mutex_unlock(&mutex);
+            job->runJob(jobIndex);
+        pthread_mutex_lock(&mutex);
+
+        jobsDone++;
+        if (jobsDone == numJobs) {
+            pthread_cond_signal(&workDone);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
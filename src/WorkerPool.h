@@ -0,0 +1,41 @@
+#pragma once
+
+#include <pthread.h>
+#include <vector>
+
+//Work that can be split into independent jobs, each run on whichever thread picks it up
+class WorkerJob
+{
+public:
+    virtual ~WorkerJob() {}
+    virtual void runJob(int jobIndex) = 0;
+};
+
+//A fixed set of threads that run the jobs of a WorkerJob in parallel
+//The thread calling run works on jobs too, so a pool of n threads starts n - 1 of its own
+class WorkerPool
+{
+public:
+    WorkerPool();
+    ~WorkerPool();
+    void start(int numThreads);
+    void stop();
+    int getNumThreads();
+    void run(WorkerJob *job, int numJobs);
+private:
+    static void *threadMain(void *pool);
+    void workLoop();
+    void runJobs();
+
+    std::vector<pthread_t> threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t workReady;
+    pthread_cond_t workDone;
+
+    WorkerJob *currJob;
+    int numJobs;
+    int nextJob;
+    int jobsDone;
+    unsigned int generation;
+    bool stopping;
+};
@@ -1,10 +1,34 @@
 #include "ofMain.h"
 #include "BounceBox.h"
 #include "ofAppGlutWindow.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
 
 //========================================================================
-int main( ){
+//Usage: BounceBox [--vision-threads N] [--boxes COLSxROWS]
+//N defaults to one thread per core, and there is one box by default
+int main(int argc, char *argv[]){
+    int numVisionThreads = 0;
+    int shardCols = 1;
+    int shardRows = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--vision-threads") == 0 && i + 1 < argc) {
+            numVisionThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--boxes") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &shardCols, &shardRows) != 2 || shardCols < 1 || shardRows < 1) {
+                printf("--boxes expects COLSxROWS, e.g. 4x3\n");
+                return 1;
+            }
+            //Every box must fit in the shared state export
+            if (shardCols * shardRows > SHARED_STATE_MAX_SHARDS) {
+                printf("--boxes allows at most %d boxes\n", SHARED_STATE_MAX_SHARDS);
+                return 1;
+            }
+        }
+    }
+
     ofAppGlutWindow window;
 	ofSetupOpenGL(&window, APP_WIDTH, APP_HEIGHT, OF_WINDOW);
-	ofRunApp(new BounceBox());
+	ofRunApp(new BounceBox(numVisionThreads, shardCols, shardRows));
 }